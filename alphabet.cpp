@@ -0,0 +1,286 @@
+// This program is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+// for more details.
+
+// You should have received a copy of the GNU General Public License along
+// with this program. If not, see <https://www.gnu.org/licenses/>.
+
+#include "alphabet.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <numeric>
+#include <sstream>
+#include <unordered_set>
+
+#include "search.h"
+
+namespace five_words {
+
+namespace {
+
+// Split text into code points. Returns false on anything that isn't valid
+// UTF-8: stray continuation bytes, truncated or overlong sequences, surrogates
+// and values past U+10FFFF.
+bool decode_utf8(const std::string &text, std::vector<uint32_t> &code_points) {
+  code_points.clear();
+  for (size_t n = 0; n < text.size();) {
+    const unsigned char lead = text[n];
+    int length;
+    uint32_t code_point;
+    if (lead < 0x80) {
+      length = 1;
+      code_point = lead;
+    } else if ((lead & 0xe0) == 0xc0) {
+      length = 2;
+      code_point = lead & 0x1f;
+    } else if ((lead & 0xf0) == 0xe0) {
+      length = 3;
+      code_point = lead & 0x0f;
+    } else if ((lead & 0xf8) == 0xf0) {
+      length = 4;
+      code_point = lead & 0x07;
+    } else {
+      return false;
+    }
+    if (n + length > text.size())
+      return false;
+    for (int byte = 1; byte < length; byte++) {
+      const unsigned char continuation = text[n + byte];
+      if ((continuation & 0xc0) != 0x80)
+        return false;
+      code_point = (code_point << 6) | (continuation & 0x3f);
+    }
+    static const uint32_t SHORTEST[] = {0, 0, 0x80, 0x800, 0x10000};
+    if (code_point < SHORTEST[length] || code_point > 0x10ffff ||
+        (code_point >= 0xd800 && code_point <= 0xdfff))
+      return false;
+    code_points.push_back(code_point);
+    n += length;
+  }
+  return true;
+}
+
+std::string encode_utf8(uint32_t code_point) {
+  std::string text;
+  if (code_point < 0x80) {
+    text += static_cast<char>(code_point);
+  } else if (code_point < 0x800) {
+    text += static_cast<char>(0xc0 | (code_point >> 6));
+    text += static_cast<char>(0x80 | (code_point & 0x3f));
+  } else if (code_point < 0x10000) {
+    text += static_cast<char>(0xe0 | (code_point >> 12));
+    text += static_cast<char>(0x80 | ((code_point >> 6) & 0x3f));
+    text += static_cast<char>(0x80 | (code_point & 0x3f));
+  } else {
+    text += static_cast<char>(0xf0 | (code_point >> 18));
+    text += static_cast<char>(0x80 | ((code_point >> 12) & 0x3f));
+    text += static_cast<char>(0x80 | ((code_point >> 6) & 0x3f));
+    text += static_cast<char>(0x80 | (code_point & 0x3f));
+  }
+  return text;
+}
+
+bool is_space(uint32_t code_point) {
+  return code_point == ' ' || (code_point >= '\t' && code_point <= '\r');
+}
+
+// As many blocks as Dictionary's 'etaoinshrldu'
+constexpr size_t NUMBER_OF_BLOCKS = 12;
+
+// Every symbol of an alphabet of alphabet_size, as bits of a Mask
+template <typename Mask> Mask all_symbols(size_t alphabet_size) {
+  return alphabet_size >= 8 * sizeof(Mask) ? ~Mask(0)
+                                           : (Mask(1) << alphabet_size) - 1;
+}
+
+// The words and blocks of dictionary as bitmaps of type Mask, ready for
+// search(), with excluded_letters taken out of what's left
+template <typename Mask> struct AlphabetWords {
+  AlphabetWords(const AlphabetDictionary &dictionary, const Options &options)
+      : masks(dictionary.size(), 0) {
+    for (size_t n = 0; n < masks.size(); n++)
+      for (const uint8_t symbol : dictionary.spellings()[n])
+        masks[n] |= Mask(1) << symbol;
+    for (const int symbol : dictionary.block_symbols())
+      blocks.push_back(symbol < 0 ? Mask(0) : Mask(1) << symbol);
+
+    full = all_symbols<Mask>(dictionary.alphabet_size());
+    const size_t excludable =
+        std::min<size_t>(dictionary.alphabet_size(), 32);
+    for (size_t symbol = 0; symbol < excludable; symbol++)
+      if ((options.excluded_letters >> symbol) & 1)
+        full &= ~(Mask(1) << symbol);
+  }
+
+  SearchWords<Mask> search_words(const AlphabetDictionary &dictionary) const {
+    return {masks, dictionary.boundaries(), blocks, full};
+  }
+
+  std::vector<Mask> masks;
+  std::vector<Mask> blocks;
+  Mask full;
+};
+
+// Solver::solve's search on bitmaps wider than 32 bits, looking through the
+// candidates for the last word
+template <typename Mask>
+StopReason solve_masks(const AlphabetDictionary &dictionary,
+                       const Options &options, Visitor &visitor) {
+  const AlphabetWords<Mask> words(dictionary, options);
+  return search(BitmapLetters<Mask>(), words.search_words(dictionary),
+                options, visitor);
+}
+
+// And on 32 bits, exactly as Solver::solve, with the last word looked up and,
+// for 26 symbols or fewer, a memo of pairs
+StopReason solve_narrow(const AlphabetDictionary &dictionary,
+                        const Options &options, Visitor &visitor) {
+  const AlphabetWords<uint32_t> words(dictionary, options);
+  ClosingWords closing_words(dictionary.alphabet_size(), WORD_LENGTH);
+  closing_words.assign(words.masks);
+  std::unique_ptr<EpochBitset> memo;
+  if (dictionary.alphabet_size() <= ALPHABET_SIZE)
+    memo.reset(new EpochBitset(size_t(1) << dictionary.alphabet_size()));
+  const IndexedLetters letters(
+      all_symbols<uint32_t>(dictionary.alphabet_size()), memo.get(),
+      closing_words);
+  return search(letters, words.search_words(dictionary), options, visitor);
+}
+
+} // namespace
+
+Alphabet::Alphabet() {
+  for (char c = 'a'; c <= 'z'; c++) {
+    numbers_[c] = static_cast<int>(code_points_.size());
+    code_points_.push_back(c);
+  }
+}
+
+bool Alphabet::assign(const std::string &symbols) {
+  std::vector<uint32_t> decoded;
+  if (!decode_utf8(symbols, decoded))
+    return false;
+  std::vector<uint32_t> code_points;
+  std::unordered_map<uint32_t, int> numbers;
+  for (const uint32_t code_point : decoded) {
+    if (is_space(code_point) || numbers.count(code_point) != 0)
+      continue;
+    if (code_points.size() == MAX_ALPHABET_SIZE)
+      return false;
+    numbers[code_point] = static_cast<int>(code_points.size());
+    code_points.push_back(code_point);
+  }
+  code_points_.swap(code_points);
+  numbers_.swap(numbers);
+  return true;
+}
+
+std::string Alphabet::symbol(int n) const {
+  return encode_utf8(code_points_[n]);
+}
+
+bool Alphabet::spell(const std::string &word,
+                     std::vector<int> &symbols) const {
+  std::vector<uint32_t> code_points;
+  if (!decode_utf8(word, code_points))
+    return false;
+  symbols.clear();
+  for (const uint32_t code_point : code_points) {
+    const auto found = numbers_.find(code_point);
+    if (found == numbers_.end())
+      return false;
+    symbols.push_back(found->second);
+  }
+  return true;
+}
+
+bool read_alphabet(const std::string &filename, Alphabet &alphabet) {
+  std::ifstream in(filename);
+  if (!in.is_open())
+    return false;
+  std::ostringstream symbols;
+  symbols << in.rdbuf();
+  return alphabet.assign(symbols.str());
+}
+
+AlphabetDictionary::AlphabetDictionary(
+    const std::vector<std::string> &word_list, const Alphabet &alphabet)
+    : alphabet_size_(alphabet.size()) {
+  // First the usable words, the first for each set of symbols, keyed on
+  // their symbols in order
+  std::vector<std::string> unique_words;
+  std::vector<std::array<uint8_t, WORD_LENGTH>> unique_spellings;
+  std::unordered_set<std::string> seen;
+  std::vector<size_t> symbol_counts(alphabet.size(), 0);
+  std::vector<int> symbols;
+  for (const auto &word : word_list) {
+    if (!alphabet.spell(word, symbols) || symbols.size() != WORD_LENGTH)
+      continue;
+    std::array<uint8_t, WORD_LENGTH> spelling;
+    std::copy(symbols.begin(), symbols.end(), spelling.begin());
+    std::string key(spelling.begin(), spelling.end());
+    std::sort(key.begin(), key.end());
+    if (std::adjacent_find(key.begin(), key.end()) != key.end() ||
+        !seen.insert(key).second)
+      continue;
+    unique_words.push_back(word);
+    unique_spellings.push_back(spelling);
+    for (const int symbol : symbols)
+      symbol_counts[symbol]++;
+  }
+
+  // Then blocks by symbol, most common first, as with 'etaoinshrldu' for
+  // English
+  std::vector<int> by_count(alphabet.size());
+  std::iota(by_count.begin(), by_count.end(), 0);
+  std::stable_sort(by_count.begin(), by_count.end(),
+                   [&symbol_counts](int a, int b) {
+                     return symbol_counts[a] > symbol_counts[b];
+                   });
+  for (const int symbol : by_count)
+    if (block_symbols_.size() < NUMBER_OF_BLOCKS && symbol_counts[symbol] > 0)
+      block_symbols_.push_back(symbol);
+  block_symbols_.push_back(-1);
+
+  std::vector<std::vector<size_t>> blocks(block_symbols_.size());
+  for (size_t n = 0; n < unique_words.size(); n++) {
+    const auto &spelling = unique_spellings[n];
+    size_t block = 0;
+    while (block_symbols_[block] >= 0 &&
+           std::find(spelling.begin(), spelling.end(),
+                     block_symbols_[block]) == spelling.end())
+      block++;
+    blocks[block].push_back(n);
+  }
+
+  for (const auto &block : blocks) {
+    boundaries_.push_back(words_.size());
+    for (const size_t n : block) {
+      words_.push_back(unique_words[n]);
+      spellings_.push_back(unique_spellings[n]);
+    }
+  }
+  boundaries_.push_back(words_.size());
+}
+
+StopReason solve(const AlphabetDictionary &dictionary, const Options &options,
+                 Visitor &visitor) {
+  if (dictionary.alphabet_size() <= 32)
+    return solve_narrow(dictionary, options, visitor);
+#ifdef __SIZEOF_INT128__
+  if (dictionary.alphabet_size() > 64)
+    return solve_masks<unsigned __int128>(dictionary, options, visitor);
+#endif
+  return solve_masks<uint64_t>(dictionary, options, visitor);
+}
+
+} // namespace five_words
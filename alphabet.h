@@ -0,0 +1,111 @@
+// This program is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+// for more details.
+
+// You should have received a copy of the GNU General Public License along
+// with this program. If not, see <https://www.gnu.org/licenses/>.
+
+// The same search as Solver's for languages other than English: words are
+// decoded from UTF-8 against an alphabet of up to 128 symbols, and the search
+// runs on the narrowest of uint32_t, uint64_t and unsigned __int128 that has a
+// bit for every symbol.
+
+#ifndef FIVE_WORDS_ALPHABET_H
+#define FIVE_WORDS_ALPHABET_H
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "five_words.h"
+
+namespace five_words {
+
+// The widest bitmap is unsigned __int128 where the compiler has it
+#ifdef __SIZEOF_INT128__
+constexpr int MAX_ALPHABET_SIZE = 128;
+#else
+constexpr int MAX_ALPHABET_SIZE = 64;
+#endif
+
+// The symbols words are spelt with, each a Unicode code point, numbered in
+// the order given
+class Alphabet {
+public:
+  // a to z
+  Alphabet();
+
+  // Replace the symbols with every character of symbols other than
+  // whitespace, in order, ignoring repeats. Returns false, leaving the
+  // alphabet as it was, if symbols isn't valid UTF-8 or has more than
+  // MAX_ALPHABET_SIZE symbols.
+  bool assign(const std::string &symbols);
+
+  size_t size() const { return code_points_.size(); }
+  // The UTF-8 for symbol number n
+  std::string symbol(int n) const;
+
+  // The symbol numbers of word, in order. Returns false if word isn't valid
+  // UTF-8 or has a character not in the alphabet.
+  bool spell(const std::string &word, std::vector<int> &symbols) const;
+
+private:
+  std::vector<uint32_t> code_points_;
+  std::unordered_map<uint32_t, int> numbers_;
+};
+
+// Read an alphabet from filename (see Alphabet::assign). Returns false if the
+// file couldn't be opened or doesn't hold a valid alphabet.
+bool read_alphabet(const std::string &filename, Alphabet &alphabet);
+
+// Like Dictionary, for words of WORD_LENGTH symbols of alphabet with no
+// repeats: the first word for each set of symbols gets an id, in blocks by the
+// most common symbols in the word list, with a catch-all block at the end
+class AlphabetDictionary {
+public:
+  AlphabetDictionary(const std::vector<std::string> &word_list,
+                     const Alphabet &alphabet);
+
+  size_t size() const { return words_.size(); }
+  const std::string &word(uint32_t id) const { return words_[id]; }
+  size_t alphabet_size() const { return alphabet_size_; }
+
+  // The symbol numbers of each word, and the symbol of each block (-1 for
+  // the catch-all block), whose words run from boundaries()[n] up to (but not
+  // including) boundaries()[n + 1]. The search turns these into bitmaps of
+  // whatever width it runs at.
+  const std::vector<std::array<uint8_t, WORD_LENGTH>> &spellings() const {
+    return spellings_;
+  }
+  const std::vector<size_t> &boundaries() const { return boundaries_; }
+  const std::vector<int> &block_symbols() const { return block_symbols_; }
+
+private:
+  size_t alphabet_size_;
+  std::vector<std::string> words_;
+  std::vector<std::array<uint8_t, WORD_LENGTH>> spellings_;
+  std::vector<size_t> boundaries_;
+  std::vector<int> block_symbols_;
+};
+
+// Find every set of five words in dictionary with no symbols in common. The
+// search is Solver's (see search.h), instantiated for the narrowest bitmap
+// type with room for the alphabet. Up to 32 symbols it looks up the last word
+// in ClosingWords, and up to 26 it keeps Solver's memo of pairs too; a table
+// over every pair of bitmaps isn't possible beyond that, and wider bitmaps
+// scan the candidates for the last word. Honors the limit, deadline and
+// thread count in options, and excluded_letters for the first 32 symbols.
+StopReason solve(const AlphabetDictionary &dictionary, const Options &options,
+                 Visitor &visitor);
+
+} // namespace five_words
+
+#endif
@@ -0,0 +1,176 @@
+// This program is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+// for more details.
+
+// You should have received a copy of the GNU General Public License along
+// with this program. If not, see <https://www.gnu.org/licenses/>.
+
+#include "budget.h"
+
+#include <algorithm>
+#include <cctype>
+#include <unordered_set>
+
+#include "search.h"
+
+namespace five_words {
+
+namespace {
+
+// Letter counts packed into 64 bit words, five bits a letter: a guard bit on
+// top of four bits of count. What's left of a budget is kept with every guard
+// bit set, so subtracting a word's counts (which have none) only clears the
+// guard bit of a letter it has more of than are left, and never borrows into
+// the next letter.
+constexpr int FIELD_BITS = 5;
+constexpr int LETTERS_PER_LANE = 12;
+constexpr int LANES = (ALPHABET_SIZE + LETTERS_PER_LANE - 1) / LETTERS_PER_LANE;
+constexpr uint64_t GUARD = uint64_t(1) << (FIELD_BITS - 1);
+// The guard bit of every field, 2^4 + 2^9 + ... + 2^59
+constexpr uint64_t GUARDS =
+    GUARD * (((uint64_t(1) << (FIELD_BITS * LETTERS_PER_LANE)) - 1) /
+             ((uint64_t(1) << FIELD_BITS) - 1));
+
+using Tally = std::array<uint64_t, LANES>;
+
+// With guard set, the fields past 'z' in the last lane get a guard bit too,
+// so that they pass fits() along with the rest
+Tally pack(const std::array<uint8_t, ALPHABET_SIZE> &counts, uint64_t guard) {
+  Tally tally;
+  tally.fill(guard != 0 ? GUARDS : 0);
+  for (int letter = 0; letter < ALPHABET_SIZE; letter++)
+    tally[letter / LETTERS_PER_LANE] |=
+        uint64_t(counts[letter])
+        << (FIELD_BITS * (letter % LETTERS_PER_LANE));
+  return tally;
+}
+
+// Letters for search(): what's left of the budget, less a word's counts.
+// There's no memo, since what's left of a budget doesn't fit in a table
+// index.
+class TallyLetters {
+public:
+  bool fits(const Tally &left, const Tally &word) const {
+    uint64_t guards = GUARDS;
+    for (int lane = 0; lane < LANES; lane++)
+      guards &= left[lane] - word[lane];
+    return guards == GUARDS;
+  }
+
+  Tally minus(const Tally &left, const Tally &word) const {
+    Tally result;
+    for (int lane = 0; lane < LANES; lane++)
+      result[lane] = left[lane] - word[lane];
+    return result;
+  }
+
+  bool known_bad(const Tally &) const { return false; }
+  void set_bad(const Tally &) const {}
+
+  template <typename Each>
+  void close(const Tally &left_ijkl, const std::vector<Tally> &candidate_masks,
+             const std::vector<uint32_t> &candidate_ids, size_t b,
+             Each &&each) const {
+    scan_closing_words(*this, left_ijkl, candidate_masks, candidate_ids, b,
+                       each);
+  }
+};
+
+} // namespace
+
+bool parse_budget(const std::string &spec, LetterBudget &budget) {
+  budget.fill(1);
+  for (size_t n = 0; n < spec.size();) {
+    const char letter = spec[n++];
+    if (letter < 'a' || letter > 'z' || n == spec.size() ||
+        !std::isdigit(static_cast<unsigned char>(spec[n])))
+      return false;
+    int count = 0;
+    while (n < spec.size() && std::isdigit(static_cast<unsigned char>(spec[n])))
+      count = std::min(count * 10 + (spec[n++] - '0'), MAX_LETTER_BUDGET + 1);
+    if (count > MAX_LETTER_BUDGET)
+      return false;
+    budget[letter - 'a'] = count;
+  }
+  return true;
+}
+
+BudgetDictionary::BudgetDictionary(const std::vector<std::string> &word_list) {
+  // The same blocks as Dictionary, see there
+  const std::string letters = "etaoinshrldu";
+  for (const char letter : letters)
+    letter_bitmaps_.push_back(uint32_t(1) << (letter - 'a'));
+  letter_bitmaps_.push_back(0);
+
+  std::vector<std::vector<std::string>> block_words(letter_bitmaps_.size());
+  std::vector<std::vector<std::array<uint8_t, ALPHABET_SIZE>>> block_counts(
+      letter_bitmaps_.size());
+  std::unordered_set<std::string> seen;
+  for (const auto &word : word_list) {
+    if (word.length() != WORD_LENGTH ||
+        std::any_of(word.begin(), word.end(),
+                    [](char c) { return c < 'a' || c > 'z'; }))
+      continue;
+    std::array<uint8_t, ALPHABET_SIZE> counts = {};
+    uint32_t bitmap = 0;
+    for (const char c : word) {
+      counts[c - 'a']++;
+      bitmap |= uint32_t(1) << (c - 'a');
+    }
+    if (!seen.insert(std::string(counts.begin(), counts.end())).second)
+      continue;
+    size_t block = 0;
+    while (letter_bitmaps_[block] != 0 &&
+           (bitmap & letter_bitmaps_[block]) == 0)
+      block++;
+    block_words[block].push_back(word);
+    block_counts[block].push_back(counts);
+  }
+
+  for (size_t block = 0; block < block_words.size(); block++) {
+    boundaries_.push_back(words_.size());
+    words_.insert(words_.end(), block_words[block].begin(),
+                  block_words[block].end());
+    counts_.insert(counts_.end(), block_counts[block].begin(),
+                   block_counts[block].end());
+  }
+  boundaries_.push_back(words_.size());
+}
+
+StopReason solve(const BudgetDictionary &dictionary, const LetterBudget &budget,
+                 const Options &options, Visitor &visitor) {
+  const size_t number_of_words = dictionary.size();
+  std::vector<Tally> word_tallies(number_of_words);
+  for (size_t n = 0; n < number_of_words; n++)
+    word_tallies[n] = pack(dictionary.counts()[n], 0);
+
+  // Every word in a block has one of its letter, so a block is only looked
+  // through while there's one of that left
+  std::vector<Tally> block_tallies;
+  for (const uint32_t letter_bitmap : dictionary.letter_bitmaps()) {
+    std::array<uint8_t, ALPHABET_SIZE> counts = {};
+    if (letter_bitmap != 0)
+      counts[__builtin_ctz(letter_bitmap)] = 1;
+    block_tallies.push_back(pack(counts, 0));
+  }
+
+  std::array<uint8_t, ALPHABET_SIZE> budget_counts;
+  for (int letter = 0; letter < ALPHABET_SIZE; letter++)
+    budget_counts[letter] =
+        ((options.excluded_letters >> letter) & 1)
+            ? 0
+            : std::max(0, std::min(budget[letter], MAX_LETTER_BUDGET));
+
+  const SearchWords<Tally> words = {word_tallies, dictionary.boundaries(),
+                                    block_tallies,
+                                    pack(budget_counts, GUARD)};
+  return search(TallyLetters(), words, options, visitor);
+}
+
+} // namespace five_words
@@ -0,0 +1,81 @@
+// This program is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+// for more details.
+
+// You should have received a copy of the GNU General Public License along
+// with this program. If not, see <https://www.gnu.org/licenses/>.
+
+// Five words using each letter at most a given number of times between them,
+// as with the tiles of a word game, rather than at most once. Words may
+// repeat letters too.
+
+#ifndef FIVE_WORDS_BUDGET_H
+#define FIVE_WORDS_BUDGET_H
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "five_words.h"
+
+namespace five_words {
+
+// How many times each letter may be used, 'a' first. The search can count up
+// to MAX_LETTER_BUDGET of a letter, more than five words could ever need
+// without several having four or more of it.
+using LetterBudget = std::array<int, ALPHABET_SIZE>;
+constexpr int MAX_LETTER_BUDGET = 15;
+
+// Parse a budget like "e2q1x0": each letter followed by how many of it there
+// are, with every letter not mentioned allowed once. Returns false if spec
+// isn't like that or a count is over MAX_LETTER_BUDGET.
+bool parse_budget(const std::string &spec, LetterBudget &budget);
+
+// Like Dictionary, for words of five letters a to z, repeats allowed: the
+// first word for each multiset of letters gets an id, in the same blocks by
+// letter
+class BudgetDictionary {
+public:
+  explicit BudgetDictionary(const std::vector<std::string> &word_list);
+
+  size_t size() const { return words_.size(); }
+  const std::string &word(uint32_t id) const { return words_[id]; }
+
+  // How many of each letter each word has, and the blocks, as with
+  // Dictionary::boundaries() and Dictionary::letter_bitmaps()
+  const std::vector<std::array<uint8_t, ALPHABET_SIZE>> &counts() const {
+    return counts_;
+  }
+  const std::vector<size_t> &boundaries() const { return boundaries_; }
+  const std::vector<uint32_t> &letter_bitmaps() const {
+    return letter_bitmaps_;
+  }
+
+private:
+  std::vector<std::string> words_;
+  std::vector<std::array<uint8_t, ALPHABET_SIZE>> counts_;
+  std::vector<size_t> boundaries_;
+  std::vector<uint32_t> letter_bitmaps_;
+};
+
+// Find every set of five words in dictionary using no more of any letter than
+// budget allows. It's Solver's search (see search.h) with the letter counts
+// packed five bits a letter into 64 bit words, so a word fits what's left of
+// the budget if subtracting it borrows from no letter's guard bit, where
+// Solver tests for no bits in common. A block is skipped once its letter is
+// used up. There's no memo, since what's left of a budget doesn't fit in a
+// table index. Honors everything in options as Solver::solve does but
+// reuse_memo, and treats excluded_letters as having none of those letters.
+StopReason solve(const BudgetDictionary &dictionary, const LetterBudget &budget,
+                 const Options &options, Visitor &visitor);
+
+} // namespace five_words
+
+#endif
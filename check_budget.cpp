@@ -0,0 +1,147 @@
+// This program is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+// for more details.
+
+// You should have received a copy of the GNU General Public License along
+// with this program. If not, see <https://www.gnu.org/licenses/>.
+
+// Checks the budget search against trying every set of five words, for small
+// random word lists with repeated letters and random budgets. Run by make
+// check-budget; exits 1 on the first difference.
+
+#include <cstdint>
+
+#include <algorithm>
+#include <mutex>
+#include <random>
+
+#include <iostream>
+
+#include <string>
+#include <vector>
+
+#include "budget.h"
+#include "five_words.h"
+
+namespace {
+
+using five_words::LetterBudget;
+using five_words::Solution;
+
+constexpr int LETTERS = 12;
+constexpr int WORDS = 40;
+constexpr int TRIALS = 30;
+
+// A set of words, each spelled out and in order, to compare by
+using Spelled = std::vector<std::string>;
+
+class Collector : public five_words::Visitor {
+public:
+  explicit Collector(const five_words::BudgetDictionary &dictionary)
+      : dictionary_(dictionary) {}
+
+  bool visit(const Solution &solution) override {
+    Spelled words;
+    for (const uint32_t id : solution)
+      words.push_back(dictionary_.word(id));
+    std::sort(words.begin(), words.end());
+    std::lock_guard<std::mutex> lock(mutex_);
+    found.push_back(words);
+    return true;
+  }
+
+  std::vector<Spelled> found;
+
+private:
+  const five_words::BudgetDictionary &dictionary_;
+  std::mutex mutex_;
+};
+
+// Every set of five of words, which are all different multisets of letters,
+// using no more of any letter than budget allows
+void brute_force(const std::vector<std::string> &words, LetterBudget &left,
+                 size_t first, Spelled &chosen, std::vector<Spelled> &found) {
+  if (chosen.size() == 5) {
+    Spelled sorted = chosen;
+    std::sort(sorted.begin(), sorted.end());
+    found.push_back(sorted);
+    return;
+  }
+  for (size_t n = first; n < words.size(); n++) {
+    bool fits = true;
+    for (const char c : words[n])
+      fits = --left[c - 'a'] >= 0 && fits;
+    if (fits) {
+      chosen.push_back(words[n]);
+      brute_force(words, left, n + 1, chosen, found);
+      chosen.pop_back();
+    }
+    for (const char c : words[n])
+      left[c - 'a']++;
+  }
+}
+
+// Adds the number of sets found to total
+bool check(std::mt19937_64 &rng, size_t &total) {
+  std::vector<std::string> word_list;
+  for (int n = 0; n < WORDS; n++) {
+    std::string word;
+    for (int letter = 0; letter < 5; letter++)
+      word += static_cast<char>('a' + rng() % LETTERS);
+    word_list.push_back(word);
+  }
+  LetterBudget budget;
+  budget.fill(0);
+  for (int letter = 0; letter < LETTERS; letter++)
+    budget[letter] = static_cast<int>(1 + rng() % 4);
+
+  // The first spelling of each multiset of letters, as the dictionary keeps
+  std::vector<std::string> unique;
+  std::vector<std::string> seen;
+  for (const auto &word : word_list) {
+    std::string letters = word;
+    std::sort(letters.begin(), letters.end());
+    if (std::find(seen.begin(), seen.end(), letters) == seen.end()) {
+      seen.push_back(letters);
+      unique.push_back(word);
+    }
+  }
+  std::vector<Spelled> expected;
+  Spelled chosen;
+  LetterBudget left = budget;
+  brute_force(unique, left, 0, chosen, expected);
+  std::sort(expected.begin(), expected.end());
+
+  const five_words::BudgetDictionary dictionary(word_list);
+  Collector collector(dictionary);
+  five_words::solve(dictionary, budget, five_words::Options(), collector);
+  std::sort(collector.found.begin(), collector.found.end());
+
+  if (collector.found != expected) {
+    std::cerr << "The budget search found " << collector.found.size()
+              << " sets where trying every one found " << expected.size()
+              << std::endl;
+    return false;
+  }
+  total += expected.size();
+  return true;
+}
+
+} // namespace
+
+int main() {
+  std::mt19937_64 rng(1);
+  size_t total = 0;
+  for (int trial = 0; trial < TRIALS; trial++)
+    if (!check(rng, total))
+      return 1;
+  std::cout << "The budget search matches trying every set (" << total
+            << " sets)" << std::endl;
+  return 0;
+}
@@ -0,0 +1,117 @@
+// This program is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+// for more details.
+
+// You should have received a copy of the GNU General Public License along
+// with this program. If not, see <https://www.gnu.org/licenses/>.
+
+// Checks ClosingWords::for_each_word against a brute force scan of every word,
+// for random words and random sets of letters left, over a range of alphabet
+// sizes and word lengths. Run by make check-closing-words; exits 1 on the
+// first difference.
+
+#include <cstdint>
+
+#include <algorithm>
+#include <random>
+
+#include <iostream>
+
+#include <vector>
+
+#include "five_words.h"
+
+namespace {
+
+using five_words::ClosingWords;
+
+constexpr int WORDS = 2000;
+constexpr int TRIALS = 20000;
+
+// Random letters of the alphabet, each in with probability density / 64
+uint32_t random_letters(std::mt19937_64 &rng, int alphabet_size,
+                        unsigned density) {
+  uint32_t letters = 0;
+  for (int letter = 0; letter < alphabet_size; letter++)
+    if (rng() % 64 < density)
+      letters |= uint32_t(1) << letter;
+  return letters;
+}
+
+// Exactly count random letters of the alphabet
+uint32_t random_word(std::mt19937_64 &rng, int alphabet_size, int count) {
+  uint32_t letters = 0;
+  while (__builtin_popcount(letters) < count)
+    letters |= uint32_t(1) << (rng() % alphabet_size);
+  return letters;
+}
+
+// The ids for_each_word should visit: every word with word_length letters,
+// all of them left, that's the first with its letters
+std::vector<uint32_t> scan(const std::vector<uint32_t> &bitmaps,
+                           const std::vector<bool> &first, int word_length,
+                           uint32_t letters_left) {
+  std::vector<uint32_t> ids;
+  for (uint32_t id = 0; id < bitmaps.size(); id++)
+    if (first[id] && __builtin_popcount(bitmaps[id]) == word_length &&
+        (bitmaps[id] & ~letters_left) == 0)
+      ids.push_back(id);
+  return ids;
+}
+
+bool check(std::mt19937_64 &rng, int alphabet_size, int word_length) {
+  // Mostly words of the right length, with repeats, and a few that aren't
+  std::vector<uint32_t> bitmaps;
+  for (int n = 0; n < WORDS; n++) {
+    if (n > 0 && rng() % 8 == 0)
+      bitmaps.push_back(bitmaps[rng() % n]);
+    else if (rng() % 16 == 0)
+      bitmaps.push_back(random_letters(rng, alphabet_size, 16));
+    else
+      bitmaps.push_back(random_word(rng, alphabet_size, word_length));
+  }
+  std::vector<bool> first(WORDS);
+  for (int n = 0; n < WORDS; n++)
+    first[n] = std::find(bitmaps.begin(), bitmaps.begin() + n, bitmaps[n]) ==
+               bitmaps.begin() + n;
+  ClosingWords closing_words(alphabet_size, word_length);
+  closing_words.assign(bitmaps);
+
+  for (int trial = 0; trial < TRIALS; trial++) {
+    // As many letters left as the search can have once four words are used,
+    // from one short of word_length up to 32 - 4 * 5 = 12 letters
+    const int count =
+        std::min<int>(alphabet_size, word_length - 1 + rng() % 9);
+    const uint32_t letters_left = random_word(rng, alphabet_size, count);
+
+    std::vector<uint32_t> visited;
+    closing_words.for_each_word(
+        letters_left, [&visited](uint32_t id) { visited.push_back(id); });
+    std::sort(visited.begin(), visited.end());
+    if (visited != scan(bitmaps, first, word_length, letters_left)) {
+      std::cerr << "ClosingWords(" << alphabet_size << ", " << word_length
+                << ") differs from a scan for letters left 0x" << std::hex
+                << letters_left << std::dec << std::endl;
+      return false;
+    }
+  }
+  return true;
+}
+
+} // namespace
+
+int main() {
+  std::mt19937_64 rng(1);
+  for (const int alphabet_size : {10, 20, 26, 32})
+    for (const int word_length : {1, 2, 3, 5})
+      if (!check(rng, alphabet_size, word_length))
+        return 1;
+  std::cout << "ClosingWords matches a scan" << std::endl;
+  return 0;
+}
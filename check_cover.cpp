@@ -0,0 +1,198 @@
+// This program is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+// for more details.
+
+// You should have received a copy of the GNU General Public License along
+// with this program. If not, see <https://www.gnu.org/licenses/>.
+
+// Checks find_covers, find_max_coverage and find_top_covers against trying
+// every set of words with no letters in common, for small random word lists
+// of mixed lengths, and that an exception thrown by a visitor comes back out
+// of find_covers. Run by make check-cover; exits 1 on the first difference.
+
+#include <cstdint>
+
+#include <algorithm>
+#include <functional>
+#include <mutex>
+#include <random>
+#include <stdexcept>
+
+#include <iostream>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "cover.h"
+#include "five_words.h"
+
+namespace {
+
+using five_words::Cover;
+using five_words::CoverGoal;
+using five_words::MixedDictionary;
+
+constexpr int LETTERS = 16;
+constexpr int WORDS = 50;
+constexpr int TRIALS = 30;
+
+class Collector : public five_words::CoverVisitor {
+public:
+  bool visit(const Cover &cover) override {
+    Cover sorted = cover;
+    std::sort(sorted.begin(), sorted.end());
+    std::lock_guard<std::mutex> lock(mutex_);
+    found.push_back(sorted);
+    return true;
+  }
+
+  std::vector<Cover> found;
+
+private:
+  std::mutex mutex_;
+};
+
+class Thrower : public five_words::CoverVisitor {
+public:
+  bool visit(const Cover &) override { throw std::runtime_error("visited"); }
+};
+
+// Call each with every set of words of dictionary with no letters in common,
+// in increasing id order, with the letters they cover
+void for_each_set(const MixedDictionary &dictionary, uint32_t first,
+                  uint32_t used, Cover &chosen,
+                  const std::function<void(const Cover &, int)> &each) {
+  if (!chosen.empty())
+    each(chosen, __builtin_popcount(used));
+  for (uint32_t id = first; id < dictionary.size(); id++) {
+    if ((dictionary.bitmap(id) & used) != 0)
+      continue;
+    chosen.push_back(id);
+    for_each_set(dictionary, id + 1, used | dictionary.bitmap(id), chosen,
+                 each);
+    chosen.pop_back();
+  }
+}
+
+bool fail(const char *search, size_t found, size_t expected) {
+  std::cerr << search << " found " << found << " sets where trying every one "
+            << "found " << expected << std::endl;
+  return false;
+}
+
+// Adds the number of sets compared to total
+bool check(std::mt19937_64 &rng, size_t &total) {
+  std::vector<std::string> word_list;
+  std::vector<double> scores;
+  for (int n = 0; n < WORDS; n++) {
+    std::string word;
+    const size_t length = 2 + rng() % 4;
+    while (word.length() < length) {
+      const char c = static_cast<char>('a' + rng() % LETTERS);
+      if (word.find(c) == std::string::npos)
+        word += c;
+    }
+    word_list.push_back(word);
+    // Whole numbers, so totals come out the same added up in any order
+    scores.push_back(static_cast<double>(rng() % 100));
+  }
+  const MixedDictionary dictionary(word_list, 2, 5, &scores);
+
+  CoverGoal goal;
+  goal.letters = static_cast<int>(8 + rng() % 6);
+  goal.max_words = static_cast<int>(rng() % 5);
+  const int max_coverage_words = static_cast<int>(1 + rng() % 4);
+  const size_t keep = 1 + rng() % 10;
+
+  std::vector<Cover> covers;
+  std::vector<double> top_scores;
+  int most = 0;
+  std::vector<Cover> best;
+  Cover chosen;
+  for_each_set(dictionary, 0, 0, chosen, [&](const Cover &set, int letters) {
+    const int words = static_cast<int>(set.size());
+    if (letters >= goal.letters &&
+        (goal.max_words == 0 || words <= goal.max_words)) {
+      covers.push_back(set);
+      double score = 0;
+      for (const uint32_t id : set)
+        score += dictionary.score(id);
+      top_scores.push_back(score);
+    }
+    if (words <= max_coverage_words) {
+      if (letters > most)
+        best.clear();
+      if (letters >= most) {
+        most = letters;
+        best.push_back(set);
+      }
+    }
+  });
+  std::sort(covers.begin(), covers.end());
+  std::sort(best.begin(), best.end());
+  std::sort(top_scores.begin(), top_scores.end(), std::greater<double>());
+  if (top_scores.size() > keep)
+    top_scores.resize(keep);
+
+  Collector collector;
+  find_covers(dictionary, goal, five_words::Options(), collector);
+  std::sort(collector.found.begin(), collector.found.end());
+  if (collector.found != covers)
+    return fail("find_covers", collector.found.size(), covers.size());
+
+  std::vector<std::pair<int, Cover>> found_best;
+  find_max_coverage(dictionary, max_coverage_words, 0, five_words::Options(),
+                    found_best);
+  std::vector<Cover> found_best_covers;
+  for (auto &covering : found_best) {
+    std::sort(covering.second.begin(), covering.second.end());
+    if (covering.first != most)
+      return fail("find_max_coverage", found_best.size(), best.size());
+    found_best_covers.push_back(covering.second);
+  }
+  std::sort(found_best_covers.begin(), found_best_covers.end());
+  if (found_best_covers != best)
+    return fail("find_max_coverage", found_best.size(), best.size());
+
+  std::vector<std::pair<double, Cover>> found_top;
+  find_top_covers(dictionary, goal, keep, five_words::Options(), found_top);
+  std::vector<double> found_top_scores;
+  for (const auto &scored : found_top)
+    found_top_scores.push_back(scored.first);
+  if (found_top_scores != top_scores)
+    return fail("find_top_covers", found_top.size(), top_scores.size());
+
+  if (!covers.empty()) {
+    Thrower thrower;
+    try {
+      find_covers(dictionary, goal, five_words::Options(), thrower);
+      std::cerr << "find_covers lost an exception thrown by its visitor"
+                << std::endl;
+      return false;
+    } catch (const std::runtime_error &) {
+    }
+  }
+
+  total += covers.size() + best.size() + top_scores.size();
+  return true;
+}
+
+} // namespace
+
+int main() {
+  std::mt19937_64 rng(1);
+  size_t total = 0;
+  for (int trial = 0; trial < TRIALS; trial++)
+    if (!check(rng, total))
+      return 1;
+  std::cout << "The cover searches match trying every set (" << total
+            << " sets)" << std::endl;
+  return 0;
+}
@@ -0,0 +1,157 @@
+// This program is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+// for more details.
+
+// You should have received a copy of the GNU General Public License along
+// with this program. If not, see <https://www.gnu.org/licenses/>.
+
+// Checks the generators of five_words_generator.h against Solver::solve, run
+// to the end, broken out of early and with a limit, on a random word list
+// with solutions planted in it. Needs C++20, unlike the rest of the checks.
+// Run by make check-generator; exits 1 on the first difference.
+
+#include <cstdint>
+
+#include <algorithm>
+#include <mutex>
+#include <random>
+
+#include <iostream>
+
+#include <string>
+#include <vector>
+
+#include "five_words.h"
+#include "five_words_generator.h"
+
+namespace {
+
+using five_words::Dictionary;
+using five_words::Solution;
+
+constexpr int PLANTED = 20;
+constexpr int WORDS = 600;
+constexpr size_t EARLY = 7;
+
+class Collector : public five_words::Visitor {
+public:
+  bool visit(const Solution &solution) override {
+    std::lock_guard<std::mutex> lock(mutex_);
+    found.push_back(solution);
+    return true;
+  }
+
+  std::vector<Solution> found;
+
+private:
+  std::mutex mutex_;
+};
+
+// Random words of five different letters, and the alphabet shuffled and cut
+// into five such words PLANTED times over so there's something to find
+std::vector<std::string> word_list(std::mt19937_64 &rng) {
+  std::vector<std::string> list;
+  std::string alphabet = "abcdefghijklmnopqrstuvwxyz";
+  for (int n = 0; n < PLANTED; n++) {
+    std::shuffle(alphabet.begin(), alphabet.end(), rng);
+    for (int word = 0; word < 5; word++)
+      list.push_back(alphabet.substr(word * 5, 5));
+  }
+  while (list.size() < WORDS) {
+    std::shuffle(alphabet.begin(), alphabet.end(), rng);
+    list.push_back(alphabet.substr(0, 5));
+  }
+  return list;
+}
+
+// Each solution's ids in order, and the solutions in order
+std::vector<Solution> sorted(std::vector<Solution> solutions) {
+  for (auto &solution : solutions)
+    std::sort(solution.begin(), solution.end());
+  std::sort(solutions.begin(), solutions.end());
+  return solutions;
+}
+
+bool fail(const char *what, size_t found, size_t expected) {
+  std::cerr << what << " gave " << found << " solutions where Solver::solve "
+            << "gave " << expected << std::endl;
+  return false;
+}
+
+// Whether every one of some is one of all (both sorted), with no repeats
+bool subset(const std::vector<Solution> &some,
+            const std::vector<Solution> &all) {
+  return std::adjacent_find(some.begin(), some.end()) == some.end() &&
+         std::includes(all.begin(), all.end(), some.begin(), some.end());
+}
+
+// Sets number to how many solutions there were
+bool check(size_t &number) {
+  std::mt19937_64 rng(1);
+  const Dictionary dictionary(word_list(rng));
+
+  // What the memo lets through can depend on the order pairs are searched
+  // in, so the reference is a search on one thread, in the generator's order
+  five_words::Solver solver(dictionary);
+  five_words::Options one_thread;
+  one_thread.threads = 1;
+  Collector collector;
+  solver.solve(one_thread, collector);
+  const std::vector<Solution> expected = sorted(collector.found);
+  if (expected.size() < PLANTED)
+    return fail("Solver::solve", expected.size(), PLANTED);
+
+  std::vector<Solution> all, early, limited, parallel, parallel_early;
+  for (const Solution &solution : five_words::solutions(dictionary))
+    all.push_back(solution);
+  for (const Solution &solution : five_words::solutions(dictionary)) {
+    early.push_back(solution);
+    if (early.size() == EARLY)
+      break;
+  }
+  five_words::Options limit;
+  limit.limit = EARLY;
+  for (const Solution &solution : five_words::solutions(dictionary, limit))
+    limited.push_back(solution);
+  for (const Solution &solution :
+       five_words::parallel_solutions(dictionary, one_thread))
+    parallel.push_back(solution);
+  for (const Solution &solution :
+       five_words::parallel_solutions(dictionary, five_words::Options(), 2)) {
+    parallel_early.push_back(solution);
+    if (parallel_early.size() == EARLY)
+      break;
+  }
+
+  if (sorted(all) != expected)
+    return fail("solutions", all.size(), expected.size());
+  if (early.size() != EARLY || !subset(sorted(early), expected))
+    return fail("solutions broken out of early", early.size(), EARLY);
+  if (limited != early)
+    return fail("solutions with a limit", limited.size(), EARLY);
+  if (sorted(parallel) != expected)
+    return fail("parallel_solutions", parallel.size(), expected.size());
+  if (parallel_early.size() != EARLY ||
+      !subset(sorted(parallel_early), expected))
+    return fail("parallel_solutions broken out of early",
+                parallel_early.size(), EARLY);
+  number = expected.size();
+  return true;
+}
+
+} // namespace
+
+int main() {
+  size_t number = 0;
+  if (!check(number))
+    return 1;
+  std::cout << "The generators match Solver::solve (" << number
+            << " solutions)" << std::endl;
+  return 0;
+}
@@ -0,0 +1,177 @@
+// This program is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+// for more details.
+
+// You should have received a copy of the GNU General Public License along
+// with this program. If not, see <https://www.gnu.org/licenses/>.
+
+// Checks that result files, with every combination of flags and both sizes of
+// id, and checkpoints read back as they were written, and that either is
+// refused once cut short. Run by make check-round-trip; exits 1 on the first
+// difference.
+
+#include <cstdint>
+#include <cstdio>
+
+#include <algorithm>
+#include <random>
+
+#include <fstream>
+#include <iostream>
+
+#include <string>
+#include <vector>
+
+#include "checkpoint.h"
+#include "five_words.h"
+#include "result_file.h"
+
+namespace {
+
+using five_words::Checkpoint;
+using five_words::Dictionary;
+using five_words::ResultFile;
+using five_words::Solution;
+
+const char *const RESULTS = "check_round_trip.results";
+const char *const CHECKPOINT = "check_round_trip.checkpoint";
+
+constexpr int SOLUTIONS = 5000;
+
+// The first words of five different letters, in the order of the
+// combinatorial number system, so more than 65536 of them need four byte ids
+std::vector<std::string> word_list(size_t words) {
+  std::vector<std::string> list;
+  for (uint32_t letters = 0x1f; list.size() < words;) {
+    std::string word;
+    for (int letter = 0; letter < 26; letter++)
+      if (letters & (uint32_t(1) << letter))
+        word += static_cast<char>('a' + letter);
+    list.push_back(word);
+    // The next number with five bits set
+    const uint32_t lowest = letters & -letters;
+    const uint32_t carried = letters + lowest;
+    letters = (((carried ^ letters) >> 2) / lowest) | carried;
+  }
+  return list;
+}
+
+// Five different ids of dictionary, not in order
+std::vector<Solution> random_solutions(std::mt19937_64 &rng,
+                                       const Dictionary &dictionary) {
+  std::vector<Solution> solutions(SOLUTIONS);
+  for (auto &solution : solutions) {
+    for (size_t n = 0; n < solution.size(); n++) {
+      do
+        solution[n] = static_cast<uint32_t>(rng() % dictionary.size());
+      while (std::find(solution.begin(), solution.begin() + n, solution[n]) !=
+             solution.begin() + n);
+    }
+  }
+  return solutions;
+}
+
+// Cut filename down to half its size
+void truncate(const char *filename) {
+  std::ifstream in(filename, std::ios::binary);
+  const std::string contents((std::istreambuf_iterator<char>(in)),
+                             std::istreambuf_iterator<char>());
+  in.close();
+  std::ofstream out(filename, std::ios::binary | std::ios::trunc);
+  out.write(contents.data(), contents.size() / 2);
+}
+
+bool fail(const std::string &what) {
+  std::cerr << what << std::endl;
+  return false;
+}
+
+bool check_result_file(std::mt19937_64 &rng, size_t words, uint32_t flags) {
+  const Dictionary dictionary(word_list(words));
+  std::vector<Solution> solutions = random_solutions(rng, dictionary);
+  const std::string name = std::to_string(dictionary.size()) +
+                           " words and flags " + std::to_string(flags);
+
+  if (!five_words::write_result_file(RESULTS, dictionary, solutions, flags))
+    return fail("Could not write a result file with " + name);
+  if (flags & (five_words::RESULTS_SORTED | five_words::RESULTS_DELTA)) {
+    for (auto &solution : solutions)
+      std::sort(solution.begin(), solution.end());
+    std::sort(solutions.begin(), solutions.end());
+  }
+
+  ResultFile file;
+  if (!file.open(RESULTS))
+    return fail("Could not read back a result file with " + name);
+  if (file.words() != dictionary.size() || file.size() != solutions.size())
+    return fail("A result file with " + name + " has the wrong counts");
+  for (uint32_t id = 0; id < dictionary.size(); id++)
+    if (file.word(id) != dictionary.word(id))
+      return fail("A result file with " + name + " has the wrong words");
+  for (size_t n = 0; n < solutions.size(); n++)
+    if (file.solution(n) != solutions[n])
+      return fail("A result file with " + name + " has the wrong solutions");
+
+  ResultFile cut_short;
+  truncate(RESULTS);
+  if (cut_short.open(RESULTS))
+    return fail("A result file with " + name + " was read cut short");
+  return true;
+}
+
+bool check_checkpoint(std::mt19937_64 &rng) {
+  const Dictionary dictionary(word_list(3000));
+  Checkpoint written;
+  written.fingerprint = five_words::fingerprint(dictionary, 1, 3);
+  if (written.fingerprint == five_words::fingerprint(dictionary) ||
+      written.fingerprint == five_words::fingerprint(dictionary, 2, 3))
+    return fail("Checkpoint fingerprints don't tell the shards apart");
+  for (uint32_t id = 0; id < dictionary.size(); id += 1 + rng() % 5)
+    written.finished_first_words.push_back(id);
+  written.solutions = random_solutions(rng, dictionary);
+  for (int n = 0; n < 1000; n++)
+    written.memo.push_back(rng());
+
+  Checkpoint read;
+  if (!five_words::write_checkpoint(CHECKPOINT, written) ||
+      !five_words::read_checkpoint(CHECKPOINT, read))
+    return fail("Could not write and read back a checkpoint");
+  if (read.fingerprint != written.fingerprint ||
+      read.finished_first_words != written.finished_first_words ||
+      read.solutions != written.solutions || read.memo != written.memo)
+    return fail("A checkpoint read back differs from the one written");
+
+  Checkpoint cut_short;
+  truncate(CHECKPOINT);
+  if (five_words::read_checkpoint(CHECKPOINT, cut_short))
+    return fail("A checkpoint was read cut short");
+  return true;
+}
+
+bool check_all() {
+  std::mt19937_64 rng(1);
+  for (const size_t words : {3000, 65780})
+    for (const uint32_t flags : {0, 1, 2, 3})
+      if (!check_result_file(rng, words, flags))
+        return false;
+  return check_checkpoint(rng);
+}
+
+} // namespace
+
+int main() {
+  const bool passed = check_all();
+  std::remove(RESULTS);
+  std::remove(CHECKPOINT);
+  if (!passed)
+    return 1;
+  std::cout << "Result files and checkpoints read back as written"
+            << std::endl;
+  return 0;
+}
@@ -0,0 +1,182 @@
+// This program is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+// for more details.
+
+// You should have received a copy of the GNU General Public License along
+// with this program. If not, see <https://www.gnu.org/licenses/>.
+
+#include "checkpoint.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+namespace five_words {
+
+namespace {
+
+const char MAGIC[8] = {'F', 'W', 'C', 'K', 'P', 'T', 0, 1};
+
+template <typename T>
+void write_vector(std::ostream &out, const std::vector<T> &values) {
+  const uint64_t size = values.size();
+  out.write(reinterpret_cast<const char *>(&size), sizeof(size));
+  out.write(reinterpret_cast<const char *>(values.data()),
+            size * sizeof(T));
+}
+
+template <typename T>
+bool read_vector(std::istream &in, std::vector<T> &values) {
+  uint64_t size = 0;
+  if (!in.read(reinterpret_cast<char *>(&size), sizeof(size)))
+    return false;
+  // Don't believe a corrupt size enough to allocate it
+  const auto position = in.tellg();
+  in.seekg(0, std::ios::end);
+  const auto remaining = in.tellg() - position;
+  in.seekg(position);
+  if (size > static_cast<uint64_t>(remaining) / sizeof(T))
+    return false;
+  values.resize(size);
+  return static_cast<bool>(
+      in.read(reinterpret_cast<char *>(values.data()), size * sizeof(T)));
+}
+
+} // namespace
+
+uint64_t fingerprint(const Dictionary &dictionary, int shard, int shards) {
+  // 64 bit FNV-1a, with a newline after each word, then k/n for a shard
+  uint64_t hash = 0xcbf29ce484222325;
+  const auto add = [&hash](const std::string &text) {
+    for (const char c : text) {
+      hash ^= static_cast<unsigned char>(c);
+      hash *= 0x100000001b3;
+    }
+  };
+  for (uint32_t id = 0; id < dictionary.size(); id++)
+    add(dictionary.word(id) + "\n");
+  if (shards > 0)
+    add(std::to_string(shard) + "/" + std::to_string(shards));
+  return hash;
+}
+
+bool write_checkpoint(const std::string &filename,
+                      const Checkpoint &checkpoint) {
+  const std::string temporary = filename + ".tmp";
+  {
+    std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+    out.write(MAGIC, sizeof(MAGIC));
+    out.write(reinterpret_cast<const char *>(&checkpoint.fingerprint),
+              sizeof(checkpoint.fingerprint));
+    write_vector(out, checkpoint.finished_first_words);
+    write_vector(out, checkpoint.solutions);
+    write_vector(out, checkpoint.memo);
+    out.flush();
+    if (!out)
+      return false;
+  }
+  return std::rename(temporary.c_str(), filename.c_str()) == 0;
+}
+
+bool read_checkpoint(const std::string &filename, Checkpoint &checkpoint) {
+  std::ifstream in(filename, std::ios::binary);
+  char magic[sizeof(MAGIC)];
+  return in.read(magic, sizeof(magic)) &&
+         std::memcmp(magic, MAGIC, sizeof(MAGIC)) == 0 &&
+         in.read(reinterpret_cast<char *>(&checkpoint.fingerprint),
+                 sizeof(checkpoint.fingerprint)) &&
+         read_vector(in, checkpoint.finished_first_words) &&
+         read_vector(in, checkpoint.solutions) &&
+         read_vector(in, checkpoint.memo);
+}
+
+CheckpointingVisitor::CheckpointingVisitor(
+    const Dictionary &dictionary, const Solver &solver, uint64_t fingerprint,
+    const std::string &filename, std::chrono::steady_clock::duration interval,
+    const Checkpoint &resumed)
+    : solver_(solver), filename_(filename), interval_(interval) {
+  checkpoint_.fingerprint = fingerprint;
+
+  std::vector<bool> finished(dictionary.size(), false);
+  for (const uint32_t id : resumed.finished_first_words) {
+    if (id < finished.size() && !finished[id]) {
+      finished[id] = true;
+      checkpoint_.finished_first_words.push_back(id);
+    }
+  }
+  for (const auto &solution : resumed.solutions)
+    if (solution[0] < finished.size() && finished[solution[0]])
+      checkpoint_.solutions.push_back(solution);
+
+  thread_ = std::thread([this]() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!stop_saving_.wait_for(lock, interval_,
+                                  [this]() { return finished_; })) {
+      lock.unlock();
+      save();
+      lock.lock();
+    }
+  });
+}
+
+CheckpointingVisitor::~CheckpointingVisitor() {
+  if (thread_.joinable()) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      finished_ = true;
+    }
+    stop_saving_.notify_all();
+    thread_.join();
+  }
+}
+
+bool CheckpointingVisitor::visit(const Solution &solution) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  checkpoint_.solutions.push_back(solution);
+  return true;
+}
+
+void CheckpointingVisitor::finished_first_word(uint32_t id) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  checkpoint_.finished_first_words.push_back(id);
+}
+
+bool CheckpointingVisitor::finish() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    finished_ = true;
+  }
+  stop_saving_.notify_all();
+  if (thread_.joinable())
+    thread_.join();
+  save();
+  return !failed_;
+}
+
+void CheckpointingVisitor::save() {
+  Checkpoint snapshot;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    snapshot.fingerprint = checkpoint_.fingerprint;
+    snapshot.finished_first_words = checkpoint_.finished_first_words;
+    snapshot.solutions = checkpoint_.solutions;
+  }
+  // Anything in the memo is true whichever pairs have been searched, so it
+  // doesn't have to match the rest of the snapshot exactly
+  solver_.save_memo(snapshot.memo);
+
+  const bool written = write_checkpoint(filename_, snapshot);
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (written)
+    checkpoints_written_++;
+  else
+    failed_ = true;
+}
+
+} // namespace five_words
@@ -0,0 +1,102 @@
+// This program is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+// for more details.
+
+// You should have received a copy of the GNU General Public License along
+// with this program. If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef FIVE_WORDS_CHECKPOINT_H
+#define FIVE_WORDS_CHECKPOINT_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "five_words.h"
+
+namespace five_words {
+
+// How far a solve has got: the first words (see Options::first_words) whose
+// search is done, the solutions found so far and the pair memo
+struct Checkpoint {
+  // Of the dictionary being solved, see fingerprint()
+  uint64_t fingerprint = 0;
+  std::vector<uint32_t> finished_first_words;
+  std::vector<Solution> solutions;
+  std::vector<uint64_t> memo;
+};
+
+// A hash of the words of dictionary in id order, and of which shard of the
+// search it is (see shard_first_words, 0 of 0 for all of it), so a checkpoint
+// is only resumed against the dictionary and shard it was taken from
+uint64_t fingerprint(const Dictionary &dictionary, int shard = 0,
+                     int shards = 0);
+
+// Save checkpoint to filename. It's written to a temporary file which is then
+// renamed over filename, so being killed part way through leaves the last
+// checkpoint intact. The format is the machine's own byte order, so resume on
+// the same kind of machine.
+bool write_checkpoint(const std::string &filename,
+                      const Checkpoint &checkpoint);
+// Returns false if filename can't be read or isn't a checkpoint
+bool read_checkpoint(const std::string &filename, Checkpoint &checkpoint);
+
+// Collects the solutions of a solve and saves its progress to a checkpoint
+// file every interval. The saving happens on a background thread, which only
+// holds up the solver threads for as long as it takes to copy the solution
+// list; the memo is copied while they carry on.
+class CheckpointingVisitor : public Visitor {
+public:
+  // Pick up from resumed, keeping only the solutions from its finished first
+  // words, since the rest will be found again. Checkpoints are tagged with
+  // fingerprint.
+  CheckpointingVisitor(const Dictionary &dictionary, const Solver &solver,
+                       uint64_t fingerprint, const std::string &filename,
+                       std::chrono::steady_clock::duration interval,
+                       const Checkpoint &resumed = Checkpoint());
+  ~CheckpointingVisitor();
+
+  CheckpointingVisitor(const CheckpointingVisitor &) = delete;
+  CheckpointingVisitor &operator=(const CheckpointingVisitor &) = delete;
+
+  bool visit(const Solution &solution) override;
+  void finished_first_word(uint32_t id) override;
+
+  // Stop saving in the background and save one last time, once the solve is
+  // over. Returns false if any checkpoint couldn't be written.
+  bool finish();
+
+  // Every solution, including those from the resumed checkpoint
+  const std::vector<Solution> &solutions() const {
+    return checkpoint_.solutions;
+  }
+  size_t checkpoints_written() const { return checkpoints_written_; }
+
+private:
+  void save();
+
+  const Solver &solver_;
+  const std::string filename_;
+  const std::chrono::steady_clock::duration interval_;
+  std::mutex mutex_;
+  std::condition_variable stop_saving_;
+  bool finished_ = false;
+  bool failed_ = false;
+  size_t checkpoints_written_ = 0;
+  Checkpoint checkpoint_;
+  std::thread thread_;
+};
+
+} // namespace five_words
+
+#endif
@@ -0,0 +1,490 @@
+// This program is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+// for more details.
+
+// You should have received a copy of the GNU General Public License along
+// with this program. If not, see <https://www.gnu.org/licenses/>.
+
+#include "cover.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <climits>
+#include <limits>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+
+#include "stop_control.h"
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace five_words {
+
+MixedDictionary::MixedDictionary(const std::vector<std::string> &word_list,
+                                 int min_length, int max_length,
+                                 const std::vector<double> *scores)
+    : min_length_(min_length), max_length_(max_length) {
+  // Where each set of letters seen so far went
+  std::unordered_map<uint32_t, uint32_t> seen;
+  for (size_t n = 0; n < word_list.size(); n++) {
+    const std::string &word = word_list[n];
+    const double score = scores != nullptr ? (*scores)[n] : 0;
+    const int length = static_cast<int>(word.length());
+    if (length < min_length || length > max_length)
+      continue;
+    uint32_t bitmap = 0;
+    bool usable = true;
+    for (const char c : word) {
+      if (c < 'a' || c > 'z' || (bitmap & (uint32_t(1) << (c - 'a'))) != 0) {
+        usable = false;
+        break;
+      }
+      bitmap |= uint32_t(1) << (c - 'a');
+    }
+    if (!usable)
+      continue;
+    const auto inserted =
+        seen.insert(std::make_pair(bitmap, static_cast<uint32_t>(size())));
+    if (inserted.second) {
+      words_.push_back(word);
+      bitmaps_.push_back(bitmap);
+      scores_.push_back(score);
+    } else if (score > scores_[inserted.first->second]) {
+      words_[inserted.first->second] = word;
+      scores_[inserted.first->second] = score;
+    }
+  }
+}
+
+namespace {
+
+const uint32_t ALL_LETTERS = (uint32_t(1) << ALPHABET_SIZE) - 1;
+
+// Where the search has got to: the letters covered, and those either covered
+// or left out, going through the letters rarest first
+struct CoverState {
+  uint32_t used = 0;
+  uint32_t decided = 0;
+  int skipped = 0;
+  int rank = 0;
+  Cover chosen;
+  double score = 0;
+};
+
+class CoverSearch {
+public:
+  // Sets have to cover at least letters letters. That may go up as the
+  // search goes on, to narrow it down to the best sets found so far, in
+  // which case bound_by_reach should be set to prune harder.
+  CoverSearch(const MixedDictionary &dictionary,
+              const std::atomic<int> &letters, int max_words,
+              bool bound_by_reach, StopControl &stop, CoverVisitor &visitor)
+      : dictionary_(dictionary), letters_(letters), stop_(stop),
+        visitor_(visitor), bound_by_reach_(bound_by_reach),
+        max_words_(max_words > 0 ? max_words : INT_MAX) {
+    // Rarest letters first, so the branching is narrowest near the root
+    std::array<size_t, ALPHABET_SIZE> counts{};
+    for (uint32_t id = 0; id < dictionary.size(); id++)
+      for (int letter = 0; letter < ALPHABET_SIZE; letter++)
+        counts[letter] += (dictionary.bitmap(id) >> letter) & 1;
+    for (int letter = 0; letter < ALPHABET_SIZE; letter++)
+      order_[letter] = letter;
+    std::stable_sort(order_.begin(), order_.end(), [&counts](int a, int b) {
+      return counts[a] < counts[b];
+    });
+    std::array<int, ALPHABET_SIZE> rank_of;
+    for (int rank = 0; rank < ALPHABET_SIZE; rank++)
+      rank_of[order_[rank]] = rank;
+
+    // Each word goes in the bucket for its rarest letter and its length,
+    // longest first since long words get to the goal soonest
+    for (int rank = 0; rank < ALPHABET_SIZE; rank++)
+      for (int length = dictionary.max_length();
+           length >= dictionary.min_length(); length--)
+        buckets_[rank].push_back(Bucket{length, {}, {}, {}});
+    for (uint32_t id = 0; id < dictionary.size(); id++) {
+      const uint32_t bitmap = dictionary.bitmap(id);
+      int rarest = ALPHABET_SIZE;
+      for (int letter = 0; letter < ALPHABET_SIZE; letter++)
+        if ((bitmap >> letter) & 1)
+          rarest = std::min(rarest, rank_of[letter]);
+      if (rarest == ALPHABET_SIZE)
+        continue;
+      Bucket &bucket = buckets_[rarest][dictionary.max_length() -
+                                        __builtin_popcount(bitmap)];
+      bucket.bitmaps.push_back(bitmap);
+      bucket.ids.push_back(id);
+      bucket.scores.push_back(dictionary.score(id));
+    }
+
+    // Highest scoring words first within each bucket, so the sets found
+    // early on are good ones and a score bound bites sooner
+    for (auto &rank_buckets : buckets_) {
+      for (Bucket &bucket : rank_buckets) {
+        std::vector<size_t> order(bucket.ids.size());
+        for (size_t n = 0; n < order.size(); n++)
+          order[n] = n;
+        std::stable_sort(order.begin(), order.end(),
+                         [&bucket](size_t a, size_t b) {
+                           return bucket.scores[a] > bucket.scores[b];
+                         });
+        Bucket sorted{bucket.length, {}, {}, {}};
+        for (const size_t n : order) {
+          sorted.bitmaps.push_back(bucket.bitmaps[n]);
+          sorted.ids.push_back(bucket.ids[n]);
+          sorted.scores.push_back(bucket.scores[n]);
+        }
+        bucket = sorted;
+      }
+    }
+  }
+
+  // Also cut any branch that can't score more than bar (see find_top_covers)
+  void bound_by_score(const std::atomic<double> &bar) { score_bar_ = &bar; }
+
+  // Carry on from state, stopping decisions short of the leaves to hand
+  // back the states there instead if tasks isn't null
+  void search(CoverState &state, int decisions,
+              std::vector<CoverState> *tasks) {
+    while (state.rank < ALPHABET_SIZE &&
+           ((state.decided >> order_[state.rank]) & 1))
+      state.rank++;
+    if (state.rank == ALPHABET_SIZE) {
+      stop_.found(state.chosen, visitor_);
+      return;
+    }
+    if (stop_.stopped())
+      return;
+    if (tasks != nullptr && decisions == 0) {
+      tasks->push_back(state);
+      return;
+    }
+
+    const int letters = letters_.load(std::memory_order_relaxed);
+    const int needed = letters - __builtin_popcount(state.used);
+    const int words_left =
+        max_words_ - static_cast<int>(state.chosen.size());
+    // With no words to spare, everything left has to be left out
+    if (words_left == 0) {
+      if (needed <= 0)
+        stop_.found(state.chosen, visitor_);
+      return;
+    }
+    // Not enough room left to cover the letters still needed, even with
+    // the longest words
+    if (needed > 0 &&
+        static_cast<long>(needed) >
+            static_cast<long>(words_left) * dictionary_.max_length())
+      return;
+
+    const int letter = order_[state.rank];
+    const uint32_t used = state.used, decided = state.decided;
+    const int skipped = state.skipped, rank = state.rank;
+    const double score = state.score;
+
+    // The most that could be covered from here is whatever the words still
+    // compatible with the decisions so far cover between them
+    if (bound_by_reach_ && needed > 0) {
+      uint32_t reachable = used;
+      for (int later = rank; later < ALPHABET_SIZE &&
+                             (reachable | decided) != ALL_LETTERS;
+           later++)
+        for (const Bucket &bucket : buckets_[later])
+          for (const uint32_t bitmap : bucket.bitmaps)
+            if ((bitmap & decided) == 0)
+              reachable |= bitmap;
+      if (__builtin_popcount(reachable) < letters)
+        return;
+    }
+
+    // Likewise the best score possible from here is that of the best words
+    // still compatible, as many of them as there's room for
+    if (score_bar_ != nullptr) {
+      const int room =
+          std::min(words_left, (ALPHABET_SIZE - __builtin_popcount(decided)) /
+                                   dictionary_.min_length());
+      std::array<double, ALPHABET_SIZE> best;
+      int number_best = 0;
+      for (int later = rank; later < ALPHABET_SIZE && room > 0; later++) {
+        for (const Bucket &bucket : buckets_[later]) {
+          for (size_t n = 0; n < bucket.bitmaps.size(); n++) {
+            const double score = bucket.scores[n];
+            if ((bucket.bitmaps[n] & decided) != 0 || score <= 0 ||
+                (number_best == room && score <= best[room - 1]))
+              continue;
+            // Insert into the (short, descending) list of the best
+            int position = number_best < room ? number_best++ : room - 1;
+            for (; position > 0 && best[position - 1] < score; position--)
+              best[position] = best[position - 1];
+            best[position] = score;
+          }
+        }
+      }
+      double bound = state.score;
+      for (int n = 0; n < number_best; n++)
+        bound += best[n];
+      if (bound <= score_bar_->load(std::memory_order_relaxed))
+        return;
+    }
+    for (const Bucket &bucket : buckets_[rank]) {
+      if (needed - bucket.length >
+          static_cast<long>(words_left - 1) * dictionary_.max_length())
+        break;
+      for (size_t n = 0; n < bucket.bitmaps.size(); n++) {
+        const uint32_t bitmap = bucket.bitmaps[n];
+        if ((bitmap & decided) != 0)
+          continue;
+        state.used = used | bitmap;
+        state.decided = decided | bitmap;
+        state.rank = rank + 1;
+        state.score = score + bucket.scores[n];
+        state.chosen.push_back(bucket.ids[n]);
+        search(state, decisions - 1, tasks);
+        state.chosen.pop_back();
+      }
+    }
+
+    if (skipped < ALPHABET_SIZE - letters) {
+      state.used = used;
+      state.decided = decided | (uint32_t(1) << letter);
+      state.skipped = skipped + 1;
+      state.rank = rank + 1;
+      state.score = score;
+      search(state, decisions - 1, tasks);
+    }
+    state.used = used;
+    state.decided = decided;
+    state.skipped = skipped;
+    state.rank = rank;
+    state.score = score;
+  }
+
+private:
+  struct Bucket {
+    int length;
+    std::vector<uint32_t> bitmaps;
+    std::vector<uint32_t> ids;
+    std::vector<double> scores;
+  };
+
+  const MixedDictionary &dictionary_;
+  const std::atomic<int> &letters_;
+  StopControl &stop_;
+  CoverVisitor &visitor_;
+  const bool bound_by_reach_;
+  const std::atomic<double> *score_bar_ = nullptr;
+  const int max_words_;
+  std::array<int, ALPHABET_SIZE> order_;
+  std::array<std::vector<Bucket>, ALPHABET_SIZE> buckets_;
+};
+
+// Enough decisions to make plenty of tasks for the threads to share out
+constexpr int TASK_DECISIONS = 2;
+
+int thread_count(const Options &options) {
+#ifdef _OPENMP
+  return options.threads > 0 ? options.threads : omp_get_max_threads();
+#else
+  return 1;
+#endif
+}
+
+// Make the first few decisions here, then share out the branches they leave
+// between the threads. Anything thrown on one stops the search and is
+// rethrown once they're all done.
+void run_search(CoverSearch &search, StopControl &stop,
+                const Options &options) {
+  std::vector<CoverState> tasks;
+  CoverState root;
+  search.search(root, TASK_DECISIONS, &tasks);
+
+#pragma omp parallel for schedule(dynamic) num_threads(thread_count(options))
+  for (size_t n = 0; n < tasks.size(); n++) {
+    stop.guard([&]() {
+      CoverState state = tasks[n];
+      search.search(state, -1, nullptr);
+    });
+  }
+
+  stop.rethrow();
+}
+
+// Keeps the sets covering the most letters, raising the bar for the search
+// as better ones turn up
+class BestCovers : public CoverVisitor {
+public:
+  BestCovers(const MixedDictionary &dictionary, size_t keep,
+             std::atomic<int> &letters)
+      : dictionary_(dictionary), keep_(keep), letters_(letters) {}
+
+  bool visit(const Cover &cover) override {
+    uint32_t used = 0;
+    for (const uint32_t id : cover)
+      used |= dictionary_.bitmap(id);
+    const int letters = __builtin_popcount(used);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (letters < letters_.load())
+      return true;
+    if (keep_ == 0) {
+      // Every set as good as the best
+      if (!best_.empty() && letters > best_.front().first)
+        best_.clear();
+      best_.push_back(std::make_pair(letters, cover));
+      letters_.store(letters);
+    } else {
+      // The keep best, in a min-heap so the worst is the one to go
+      best_.push_back(std::make_pair(letters, cover));
+      std::push_heap(best_.begin(), best_.end(), worse);
+      if (best_.size() > keep_) {
+        std::pop_heap(best_.begin(), best_.end(), worse);
+        best_.pop_back();
+      }
+      if (best_.size() == keep_)
+        letters_.store(best_.front().first + 1);
+    }
+    return true;
+  }
+
+  // Best first
+  std::vector<std::pair<int, Cover>> sorted() {
+    std::vector<std::pair<int, Cover>> sorted = best_;
+    std::stable_sort(sorted.begin(), sorted.end(), worse);
+    return sorted;
+  }
+
+private:
+  static bool worse(const std::pair<int, Cover> &a,
+                    const std::pair<int, Cover> &b) {
+    return a.first > b.first;
+  }
+
+  const MixedDictionary &dictionary_;
+  const size_t keep_;
+  std::atomic<int> &letters_;
+  std::mutex mutex_;
+  std::vector<std::pair<int, Cover>> best_;
+};
+
+// Keeps the best scoring sets found by each thread, sharing the lowest score
+// that could still make the overall top keep
+class TopCovers : public CoverVisitor {
+public:
+  TopCovers(const MixedDictionary &dictionary, size_t keep, int threads,
+            std::atomic<double> &bar)
+      : dictionary_(dictionary), keep_(keep), bar_(bar), tops_(threads) {}
+
+  bool visit(const Cover &cover) override {
+    double score = 0;
+    for (const uint32_t id : cover)
+      score += dictionary_.score(id);
+
+#ifdef _OPENMP
+    auto &top = tops_[omp_get_thread_num()];
+#else
+    auto &top = tops_[0];
+#endif
+    if (top.size() == keep_ && score <= top.front().first)
+      return true;
+    top.push_back(std::make_pair(score, cover));
+    std::push_heap(top.begin(), top.end(), better);
+    if (top.size() > keep_) {
+      std::pop_heap(top.begin(), top.end(), better);
+      top.pop_back();
+    }
+    // This thread alone has keep sets scoring at least this much, so the
+    // overall top keep do too
+    if (top.size() == keep_) {
+      double bar = bar_.load();
+      while (top.front().first > bar &&
+             !bar_.compare_exchange_weak(bar, top.front().first)) {
+      }
+    }
+    return true;
+  }
+
+  // Best first
+  std::vector<std::pair<double, Cover>> merged() const {
+    std::vector<std::pair<double, Cover>> merged;
+    for (const auto &top : tops_)
+      merged.insert(merged.end(), top.begin(), top.end());
+    std::stable_sort(merged.begin(), merged.end(), better);
+    if (merged.size() > keep_)
+      merged.resize(keep_);
+    return merged;
+  }
+
+private:
+  static bool better(const std::pair<double, Cover> &a,
+                     const std::pair<double, Cover> &b) {
+    return a.first > b.first;
+  }
+
+  const MixedDictionary &dictionary_;
+  const size_t keep_;
+  std::atomic<double> &bar_;
+  // Min-heaps by score, so the worst is the one to go
+  std::vector<std::vector<std::pair<double, Cover>>> tops_;
+};
+
+} // namespace
+
+StopReason find_covers(const MixedDictionary &dictionary, const CoverGoal &goal,
+                       const Options &options, CoverVisitor &visitor) {
+  StopControl stop(options);
+  if (goal.letters > ALPHABET_SIZE)
+    return stop.reason();
+  const std::atomic<int> letters(goal.letters);
+  CoverSearch search(dictionary, letters, goal.max_words, false, stop,
+                     visitor);
+  run_search(search, stop, options);
+  return stop.reason();
+}
+
+StopReason find_max_coverage(const MixedDictionary &dictionary, int max_words,
+                             size_t keep, const Options &options,
+                             std::vector<std::pair<int, Cover>> &best) {
+  // Stopping after so many sets would leave the branch and bound short of
+  // the best, so there's no limit
+  Options unlimited = options;
+  unlimited.limit = 0;
+  StopControl stop(unlimited);
+  std::atomic<int> letters(1);
+  BestCovers best_covers(dictionary, keep, letters);
+  CoverSearch search(dictionary, letters, max_words, true, stop, best_covers);
+  run_search(search, stop, options);
+  best = best_covers.sorted();
+  return stop.reason();
+}
+
+StopReason find_top_covers(const MixedDictionary &dictionary,
+                           const CoverGoal &goal, size_t keep,
+                           const Options &options,
+                           std::vector<std::pair<double, Cover>> &top) {
+  Options unlimited = options;
+  unlimited.limit = 0;
+  StopControl stop(unlimited);
+  if (goal.letters > ALPHABET_SIZE || keep == 0)
+    return stop.reason();
+  const std::atomic<int> letters(goal.letters);
+  std::atomic<double> bar(-std::numeric_limits<double>::infinity());
+  TopCovers top_covers(dictionary, keep, thread_count(options), bar);
+  CoverSearch search(dictionary, letters, goal.max_words, false, stop,
+                     top_covers);
+  search.bound_by_score(bar);
+  run_search(search, stop, options);
+  top = top_covers.merged();
+  return stop.reason();
+}
+
+} // namespace five_words
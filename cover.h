@@ -0,0 +1,111 @@
+// This program is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+// for more details.
+
+// You should have received a copy of the GNU General Public License along
+// with this program. If not, see <https://www.gnu.org/licenses/>.
+
+// A more general search than Solver's: sets of any number of words, of any
+// lengths in a range, with no letters in common and covering at least a
+// given number of letters between them.
+
+#ifndef FIVE_WORDS_COVER_H
+#define FIVE_WORDS_COVER_H
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "five_words.h"
+
+namespace five_words {
+
+// The words of a word list between min_length and max_length letters long
+// with no repeated letters, keeping only the first word for each set of
+// letters, like Dictionary. If scores (one per word in word_list) are given,
+// it's the highest scoring word for each set of letters that's kept instead.
+class MixedDictionary {
+public:
+  MixedDictionary(const std::vector<std::string> &word_list, int min_length,
+                  int max_length,
+                  const std::vector<double> *scores = nullptr);
+
+  size_t size() const { return words_.size(); }
+  const std::string &word(uint32_t id) const { return words_[id]; }
+  // Bit n is set if the word contains the letter 'a' + n
+  uint32_t bitmap(uint32_t id) const { return bitmaps_[id]; }
+  // 0 if there were no scores
+  double score(uint32_t id) const { return scores_[id]; }
+  int min_length() const { return min_length_; }
+  int max_length() const { return max_length_; }
+
+private:
+  std::vector<std::string> words_;
+  std::vector<uint32_t> bitmaps_;
+  std::vector<double> scores_;
+  int min_length_;
+  int max_length_;
+};
+
+// What find_covers looks for
+struct CoverGoal {
+  // Cover at least this many of the 26 letters
+  int letters = ALPHABET_SIZE - 1;
+  // Use at most this many words (0 for no limit)
+  int max_words = 0;
+};
+
+// The ids of the words making up one set
+using Cover = std::vector<uint32_t>;
+
+// Receives sets as they are found, like Visitor
+class CoverVisitor {
+public:
+  virtual ~CoverVisitor() {}
+
+  // Called from several threads at once. Return false to stop the search.
+  virtual bool visit(const Cover &cover) = 0;
+};
+
+// Find every set of words in dictionary meeting goal, each once. Letters are
+// decided rarest first: the rarest letter not yet decided is either covered
+// by a word in which it's the rarest letter, or left out, which only so many
+// letters can be. Honors the limit, deadline and thread count in options, and
+// rethrows anything visitor throws on one of the search threads.
+StopReason find_covers(const MixedDictionary &dictionary, const CoverGoal &goal,
+                       const Options &options, CoverVisitor &visitor);
+
+// Find the sets of at most max_words words (any number if 0) in dictionary
+// with no letters in common covering the most letters: every one as good as
+// the best if keep is 0, otherwise the keep best. They're stored best first
+// in best, along with how many letters each covers. A branch and bound on
+// the same search as find_covers, where the letters to cover go up as better
+// sets are found and a branch is cut once the words still compatible with it
+// can't reach that many between them. Honors the deadline and thread count
+// in options, but not the limit, which would stop it short of the best.
+StopReason find_max_coverage(const MixedDictionary &dictionary, int max_words,
+                             size_t keep, const Options &options,
+                             std::vector<std::pair<int, Cover>> &best);
+
+// Find the keep sets meeting goal with the highest total score (see
+// MixedDictionary::score), stored best first in top along with their scores.
+// Each thread keeps its own best sets, and the lowest score that could still
+// make the top keep is shared between them, so any branch whose score so far
+// plus the best scores of the words still compatible with it can't beat that
+// is cut. Honors the deadline and thread count in options, but not the
+// limit, which would stop it short of the top keep.
+StopReason find_top_covers(const MixedDictionary &dictionary,
+                           const CoverGoal &goal, size_t keep,
+                           const Options &options,
+                           std::vector<std::pair<double, Cover>> &top);
+
+} // namespace five_words
+
+#endif
@@ -0,0 +1,632 @@
+// This program is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+// for more details.
+
+// You should have received a copy of the GNU General Public License along
+// with this program. If not, see <https://www.gnu.org/licenses/>.
+
+#include "five_words.h"
+
+#include <algorithm>
+#include <numeric>
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include <istream>
+#include <sstream>
+
+#include <bitset>
+#include <cstring>
+#include <unordered_set>
+
+#include "search.h"
+#include "stop_control.h"
+#include "word_input.h"
+
+#ifdef __has_include
+#if __has_include(<bit>)
+#include <bit>
+#endif
+#endif
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace five_words {
+
+namespace {
+
+int default_threads() {
+#ifdef _OPENMP
+  return omp_get_max_threads();
+#else
+  return 1;
+#endif
+}
+
+int thread_number() {
+#ifdef _OPENMP
+  return omp_get_thread_num();
+#else
+  return 0;
+#endif
+}
+
+int team_size() {
+#ifdef _OPENMP
+  return omp_get_num_threads();
+#else
+  return 1;
+#endif
+}
+
+// Get the number of bits set in the bitmap
+int bit_count(uint32_t bitmap) {
+#ifdef __cpp_lib_bitops
+  // C++20 only feature
+  return std::popcount(bitmap);
+#else
+  const std::bitset<8 * sizeof(uint32_t)> b(bitmap);
+  return b.count();
+#endif
+}
+
+// Trim any leading or trailing whitespace
+void trim(std::string &line) {
+  line.erase(line.begin(),
+             std::find_if(line.begin(), line.end(),
+                          [](unsigned char c) { return !std::isspace(c); }));
+  line.erase(std::find_if(line.rbegin(), line.rend(),
+                          [](unsigned char c) { return !std::isspace(c); })
+                 .base(),
+             line.end());
+}
+
+} // namespace
+
+bool read_word_list(const std::string &filename,
+                    std::vector<std::string> &word_list) {
+  return read_lines(filename, [&word_list](std::string &line) {
+    trim(line);
+    word_list.push_back(line);
+  });
+}
+
+void read_word_list(std::istream &in, std::vector<std::string> &word_list) {
+  std::string line;
+  while (std::getline(in, line)) {
+    trim(line);
+    word_list.push_back(line);
+  }
+}
+
+bool read_scored_word_list(const std::string &filename,
+                           std::vector<std::string> &word_list,
+                           std::vector<double> &scores) {
+  return read_lines(filename, [&word_list, &scores](std::string &line) {
+    std::istringstream fields(line);
+    std::string word;
+    double score = 0;
+    fields >> word >> score;
+    word_list.push_back(word);
+    scores.push_back(fields ? score : 0);
+  });
+}
+
+std::vector<uint32_t> Dictionary::block_letter_bitmaps() {
+  // Create several mutually exclusive lists of words, the first for words with
+  // an 'e', the next for words with a 't' but no 'e', the next for words with
+  // an 'a' but no 't' or 'e', and so on, with an extra list at the end that's a
+  // catch all for everything else. This allows us to more quickly prune the
+  // search space later on since we can disregard the entire block if the
+  // corresponding letter is present in the combined bitmap.
+
+  // The number of individual letter lists to make is a potential trade off,
+  // here are a few, but, empirically, the longest one 'etaoinshrldu' seems to
+  // be best.
+  // std::vector<char> letters = {'e'};
+  // std::vector<char> letters = {'e', 't', 'a', 'o', 'i', 'n'};
+  std::vector<char> letters = {'e', 't', 'a', 'o', 'i', 'n',
+                               's', 'h', 'r', 'l', 'd', 'u'};
+  std::vector<uint32_t> letter_bitmaps;
+  std::transform(letters.cbegin(), letters.cend(),
+                 std::back_inserter(letter_bitmaps),
+                 [](char letter) { return 1 << (letter - 'a'); });
+  letter_bitmaps.push_back(0xffff); // At the end, match against everything left
+  return letter_bitmaps;
+}
+
+Dictionary::Dictionary(const std::vector<std::string> &word_list) {
+  std::vector<uint32_t> &letter_bitmaps = letter_bitmaps_;
+  letter_bitmaps = block_letter_bitmaps();
+  std::vector<std::vector<uint32_t>> word_bitmaps_letters(
+      letter_bitmaps.size());
+  std::vector<std::vector<std::string>> unique_words_letters(
+      letter_bitmaps.size());
+
+  for (const auto &word : word_list) {
+    if (word.length() != WORD_LENGTH)
+      continue;
+    // Anything but a lower case ASCII letter would shift off the end of the
+    // bitmap (see alphabet.h for other alphabets)
+    if (std::any_of(word.begin(), word.end(),
+                    [](char c) { return c < 'a' || c > 'z'; }))
+      continue;
+
+    // Use a bitmap to represent a set for performance. Since there are only 26
+    // possible letters (assumes that all letters are lower case ASCII), the 32
+    // bits of a uint32_t are sufficient. Set the bit corresponding to the index
+    // of each character (e.g. 'a' = 0, 'b' = 1, ...).
+    const uint32_t bitmap = std::accumulate(
+        word.begin(), word.end(), 0,
+        [](uint32_t bitmap, const char c) { return bitmap |= 1 << (c - 'a'); });
+
+    // If there are no duplicate characters, check which collection to add it to
+    if (bit_count(bitmap) == WORD_LENGTH) {
+      for (size_t i = 0; i < letter_bitmaps.size(); i++) {
+        // If the current bitmap contains the given letter
+        if ((bitmap & letter_bitmaps[i]) != 0) {
+          // If we haven't seen this bitmap before
+          if (word_bitmaps_letters[i].end() ==
+              std::find(word_bitmaps_letters[i].begin(),
+                        word_bitmaps_letters[i].end(), bitmap)) {
+            word_bitmaps_letters[i].push_back(bitmap);
+            unique_words_letters[i].push_back(word);
+          }
+          break;
+        }
+      }
+    }
+  }
+
+  assemble(word_bitmaps_letters, unique_words_letters);
+}
+
+void Dictionary::assemble(
+    const std::vector<std::vector<uint32_t>> &word_bitmaps_letters,
+    const std::vector<std::vector<std::string>> &unique_words_letters) {
+  const size_t number_of_words = std::accumulate(
+      word_bitmaps_letters.cbegin(), word_bitmaps_letters.cend(), 0,
+      [](size_t sum, const std::vector<uint32_t> &vec) {
+        return sum + vec.size();
+      });
+
+  bitmaps_.reserve(number_of_words);
+  words_.reserve(number_of_words);
+
+  // Combine each individual letter list into one, saving the boundaries for
+  // later
+  for (size_t i = 0; i < word_bitmaps_letters.size(); i++) {
+    boundaries_.push_back(bitmaps_.size());
+    bitmaps_.insert(bitmaps_.end(), word_bitmaps_letters[i].begin(),
+                    word_bitmaps_letters[i].end());
+    words_.insert(words_.end(), unique_words_letters[i].begin(),
+                  unique_words_letters[i].end());
+  }
+  boundaries_.push_back(bitmaps_.size());
+
+  // Reset this to 0 since we're looking for the opposite now, we want all words
+  // to match with the last section
+  letter_bitmaps_[letter_bitmaps_.size() - 1] = 0;
+}
+
+bool read_dictionary(const std::string &filename, Dictionary &dictionary,
+                     size_t &lines, int threads) {
+  // Standard input and pipes can't be mapped, and can only be read once, so
+  // they go straight to read_word_list, which looks for compression without
+  // losing anything. Compressed files have to be read through from the start.
+  MappedFile file;
+  if (!is_regular_file(filename) || !file.open(filename) ||
+      detect_compression(reinterpret_cast<const unsigned char *>(file.data()),
+                         file.size()) != Compression::NONE) {
+    std::vector<std::string> word_list;
+    if (!read_word_list(filename, word_list))
+      return false;
+    lines = word_list.size();
+    dictionary = Dictionary(word_list);
+    return true;
+  }
+
+  if (threads <= 0)
+    threads = default_threads();
+  const std::vector<uint32_t> letter_bitmaps =
+      Dictionary::block_letter_bitmaps();
+  const size_t blocks = letter_bitmaps.size();
+  const char *const text = file.data();
+  const size_t size = file.size();
+
+  // Each thread's blocks, deduplicated among themselves, and how many lines
+  // it read
+  std::vector<std::vector<std::vector<uint32_t>>> thread_bitmaps(
+      threads, std::vector<std::vector<uint32_t>>(blocks));
+  std::vector<std::vector<std::vector<std::string>>> thread_words(
+      threads, std::vector<std::vector<std::string>>(blocks));
+  std::vector<size_t> thread_lines(threads, 0);
+
+#pragma omp parallel num_threads(threads)
+  {
+    const int thread = thread_number();
+    const int team = team_size();
+
+    // This thread takes the lines starting in its share of the file: from
+    // just after the first newline before its start (or the very start) up to
+    // the same point for the next thread
+    const auto line_start = [text, size](size_t offset) {
+      if (offset == 0 || offset >= size)
+        return std::min(offset, size);
+      const void *newline =
+          std::memchr(text + offset - 1, '\n', size - offset + 1);
+      return newline == nullptr
+                 ? size
+                 : static_cast<size_t>(static_cast<const char *>(newline) -
+                                       text) +
+                       1;
+    };
+    const size_t begin = line_start(size / team * thread);
+    const size_t end =
+        thread + 1 == team ? size : line_start(size / team * (thread + 1));
+
+    std::vector<std::vector<uint32_t>> &word_bitmaps_letters =
+        thread_bitmaps[thread];
+    std::vector<std::vector<std::string>> &unique_words_letters =
+        thread_words[thread];
+    std::unordered_set<uint32_t> seen;
+    size_t number_of_lines = 0;
+
+    for (size_t next = begin; next < end;) {
+      const char *first = text + next;
+      const char *newline = static_cast<const char *>(
+          std::memchr(first, '\n', end - next));
+      const char *last = newline == nullptr ? text + end : newline;
+      next = last - text + 1;
+      number_of_lines++;
+
+      // The same filter as the Dictionary constructor, on the trimmed line
+      while (first != last && std::isspace(static_cast<unsigned char>(*first)))
+        first++;
+      while (last != first &&
+             std::isspace(static_cast<unsigned char>(last[-1])))
+        last--;
+      if (last - first != WORD_LENGTH)
+        continue;
+      uint32_t bitmap = 0;
+      bool letters_only = true;
+      for (const char *c = first; c != last; c++) {
+        letters_only &= *c >= 'a' && *c <= 'z';
+        bitmap |= uint32_t(1) << ((*c - 'a') & 31);
+      }
+      if (!letters_only || bit_count(bitmap) != WORD_LENGTH ||
+          !seen.insert(bitmap).second)
+        continue;
+
+      size_t block = 0;
+      while (block < blocks && (bitmap & letter_bitmaps[block]) == 0)
+        block++;
+      if (block == blocks)
+        continue;
+      word_bitmaps_letters[block].push_back(bitmap);
+      unique_words_letters[block].push_back(std::string(first, last));
+    }
+    thread_lines[thread] = number_of_lines;
+  }
+
+  // Merge each block in file order, keeping the first word for each bitmap,
+  // the blocks in parallel
+  std::vector<std::vector<uint32_t>> word_bitmaps_letters(blocks);
+  std::vector<std::vector<std::string>> unique_words_letters(blocks);
+#pragma omp parallel for schedule(dynamic) num_threads(threads)
+  for (size_t block = 0; block < blocks; block++) {
+    std::unordered_set<uint32_t> seen;
+    for (int thread = 0; thread < threads; thread++) {
+      const std::vector<uint32_t> &bitmaps = thread_bitmaps[thread][block];
+      std::vector<std::string> &words = thread_words[thread][block];
+      for (size_t n = 0; n < bitmaps.size(); n++) {
+        if (seen.insert(bitmaps[n]).second) {
+          word_bitmaps_letters[block].push_back(bitmaps[n]);
+          unique_words_letters[block].push_back(std::move(words[n]));
+        }
+      }
+    }
+  }
+
+  lines = std::accumulate(thread_lines.begin(), thread_lines.end(),
+                          size_t(0));
+  dictionary = Dictionary();
+  dictionary.letter_bitmaps_ = letter_bitmaps;
+  dictionary.assemble(word_bitmaps_letters, unique_words_letters);
+  return true;
+}
+
+constexpr uint32_t ClosingWords::NO_WORD;
+
+ClosingWords::ClosingWords(int alphabet_size, int word_length)
+    : word_length_(word_length),
+      choose_(alphabet_size + 1, std::vector<uint32_t>(word_length + 1, 0)) {
+  for (int n = 0; n <= alphabet_size; n++) {
+    choose_[n][0] = 1;
+    for (int k = 1; k <= word_length && k <= n; k++)
+      choose_[n][k] = choose_[n - 1][k - 1] + (k < n ? choose_[n - 1][k] : 0);
+  }
+  const uint32_t sets = choose_[alphabet_size][word_length];
+  present_.assign((sets + 63) / 64, 0);
+  ids_.assign(sets, NO_WORD);
+}
+
+void ClosingWords::assign(const std::vector<uint32_t> &bitmaps) {
+  std::fill(present_.begin(), present_.end(), 0);
+  for (uint32_t id = 0; id < bitmaps.size(); id++) {
+    if (bit_count(bitmaps[id]) != word_length_)
+      continue;
+    const uint32_t r = rank(bitmaps[id]);
+    if ((present_[r / 64] >> (r % 64)) & 1)
+      continue;
+    present_[r / 64] |= uint64_t(1) << (r % 64);
+    ids_[r] = id;
+  }
+}
+
+// Every letter a to z, as a bitmap
+constexpr uint32_t ALL_LETTERS = (uint32_t(1) << ALPHABET_SIZE) - 1;
+
+// One bit per possible combined bitmap of a pair of words, set once we know
+// there's no way to finish that pair. Probes into this are effectively random
+// so it gets huge page backing where possible (see large_table.h), and it's
+// epoch tagged so starting another solve doesn't mean clearing 16MB.
+Solver::Solver() : known_bad_ij_(1 << 26) {}
+
+Solver::Solver(const Dictionary &dictionary)
+    : dictionary_(&dictionary), known_bad_ij_(1 << 26) {}
+
+void Solver::save_memo(std::vector<uint64_t> &bits) const {
+  bits.resize((1 << 26) / 64);
+  known_bad_ij_.copy_to(bits.data());
+}
+
+void Solver::load_memo(const std::vector<uint64_t> &bits) {
+  if (bits.size() == (1 << 26) / 64)
+    known_bad_ij_.copy_from(bits.data());
+}
+
+StopReason Solver::solve(const Options &options, Visitor &visitor) {
+  return solve(*dictionary_, options, visitor);
+}
+
+StopReason Solver::solve(const Dictionary &dictionary, const Options &options,
+                         Visitor &visitor) {
+  begin_pairs(dictionary, options);
+  const SearchWords<uint32_t> words = {dictionary.bitmaps(),
+                                       dictionary.boundaries(),
+                                       dictionary.letter_bitmaps(),
+                                       pairs_letters_};
+  const IndexedLetters letters(ALL_LETTERS, &known_bad_ij_, closing_words_);
+  return search(letters, words, options, visitor);
+}
+
+void Solver::begin_pairs(const Dictionary &dictionary, const Options &options) {
+  if (!options.reuse_memo)
+    known_bad_ij_.clear();
+  closing_words_.assign(dictionary.bitmaps());
+  pairs_dictionary_ = &dictionary;
+  // Treat excluded letters as already used, so every overlap test rules out
+  // words containing them too
+  pairs_letters_ = ALL_LETTERS & ~options.excluded_letters;
+}
+
+void Solver::solve_pair(uint32_t i, uint32_t j, std::vector<Solution> &found) {
+  const Dictionary &dictionary = *pairs_dictionary_;
+  const SearchWords<uint32_t> words = {dictionary.bitmaps(),
+                                       dictionary.boundaries(),
+                                       dictionary.letter_bitmaps(),
+                                       pairs_letters_};
+  const IndexedLetters letters(ALL_LETTERS, &known_bad_ij_, closing_words_);
+  if (!letters.fits(words.full, words.masks[i]))
+    return;
+  const uint32_t left_i = letters.minus(words.full, words.masks[i]);
+  if (j <= i || !letters.fits(left_i, words.masks[j]))
+    return;
+  search_pair(letters, words, i, j, letters.minus(left_i, words.masks[j]),
+              candidate_bitmaps_, candidate_ids_,
+              [&found](const Solution &solution) {
+                found.push_back(solution);
+              });
+}
+
+std::vector<uint32_t> shard_first_words(const Dictionary &dictionary,
+                                        int shard, int shards) {
+  const std::vector<uint32_t> &word_bitmaps = dictionary.bitmaps();
+  const size_t number_of_words = word_bitmaps.size();
+
+  // The work for a first word i is roughly the candidate scans for each of
+  // its second words j, each of which looks at (at most) the words after j
+  std::vector<uint64_t> costs(number_of_words, 0);
+#pragma omp parallel for schedule(dynamic)
+  for (size_t i = 0; i < number_of_words; i++) {
+    uint64_t cost = 1;
+    for (size_t j = i + 1; j < number_of_words; j++)
+      if ((word_bitmaps[i] & word_bitmaps[j]) == 0)
+        cost += number_of_words - j;
+    costs[i] = cost;
+  }
+
+  // Longest processing time first: hand out the most expensive words first,
+  // each to the piece with the least work so far, breaking ties by id and by
+  // piece number so every process makes the same choices
+  std::vector<uint32_t> order(number_of_words);
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(),
+                   [&costs](uint32_t a, uint32_t b) {
+                     return costs[a] > costs[b];
+                   });
+  std::vector<uint64_t> loads(std::max(shards, 1), 0);
+  std::vector<uint32_t> first_words;
+  for (const uint32_t i : order) {
+    const auto lightest = std::min_element(loads.begin(), loads.end());
+    *lightest += costs[i];
+    if (lightest - loads.begin() == shard)
+      first_words.push_back(i);
+  }
+  // Back in id order, which is also roughly most to least work, so the
+  // dynamic schedule of the search balances well
+  std::sort(first_words.begin(), first_words.end());
+  return first_words;
+}
+
+StopReason solve_containing(const Dictionary &dictionary,
+                            const std::vector<uint32_t> &seeds,
+                            const Options &options, Visitor &visitor) {
+  const std::vector<uint32_t> &word_bitmaps = dictionary.bitmaps();
+  const size_t number_of_words = word_bitmaps.size();
+  const uint32_t excluded_letters = options.excluded_letters;
+  const int threads = options.threads > 0 ? options.threads : default_threads();
+
+  // A solution using several seeds is only looked for from the first of them,
+  // so the search from each seed skips the seeds before it
+  std::vector<size_t> seed_order(number_of_words, seeds.size());
+  for (size_t n = seeds.size(); n-- > 0;)
+    seed_order[seeds[n]] = n;
+
+  StopControl stop(options);
+
+#pragma omp parallel num_threads(threads) shared(stop)
+  {
+    std::vector<uint32_t> candidate_bitmaps, next_bitmaps;
+    std::vector<uint32_t> candidate_indices, next_indices;
+
+#pragma omp for schedule(dynamic) nowait
+    for (size_t n = 0; n < seeds.size(); n++) {
+      const uint32_t seed = seeds[n];
+      if (stop.stopped() || seed_order[seed] != n ||
+          (word_bitmaps[seed] & excluded_letters) != 0)
+        continue;
+      stop.guard([&]() {
+        const auto used_seed = word_bitmaps[seed] | excluded_letters;
+
+        // Every word that could go with the seed
+        candidate_bitmaps.clear();
+        candidate_indices.clear();
+        for (size_t k = 0; k < number_of_words; k++) {
+          if ((used_seed & word_bitmaps[k]) == 0 && seed_order[k] > n) {
+            candidate_bitmaps.push_back(word_bitmaps[k]);
+            candidate_indices.push_back(k);
+          }
+        }
+
+        const auto num_candidates = candidate_bitmaps.size();
+        for (size_t a = 0; a < num_candidates && !stop.stopped(); a++) {
+          const auto used_a = used_seed | candidate_bitmaps[a];
+
+          // Then the words that could go with both, leaving the same three
+          // levels as the main search
+          next_bitmaps.clear();
+          next_indices.clear();
+          for (size_t k = a + 1; k < num_candidates; k++) {
+            if ((used_a & candidate_bitmaps[k]) == 0) {
+              next_bitmaps.push_back(candidate_bitmaps[k]);
+              next_indices.push_back(candidate_indices[k]);
+            }
+          }
+
+          const auto num_next = next_bitmaps.size();
+          if (num_next < WORD_LENGTH - 2)
+            continue;
+          for (size_t b = 0; b < num_next; b++) {
+            const auto used_ab = used_a | next_bitmaps[b];
+            for (size_t c = b + 1; c < num_next; c++) {
+              if ((used_ab & next_bitmaps[c]) != 0)
+                continue;
+              const auto used_abc = used_ab | next_bitmaps[c];
+              for (size_t d = c + 1; d < num_next; d++) {
+                if ((used_abc & next_bitmaps[d]) != 0)
+                  continue;
+                Solution solution = {{seed, candidate_indices[a],
+                                      next_indices[b], next_indices[c],
+                                      next_indices[d]}};
+                std::sort(solution.begin(), solution.end());
+                stop.found(solution, visitor);
+              }
+            }
+          }
+        }
+      });
+    }
+  }
+
+  stop.rethrow();
+  return stop.reason();
+}
+
+class SolutionStream::QueueVisitor : public Visitor {
+public:
+  explicit QueueVisitor(SolutionStream &stream) : stream_(stream) {}
+
+  bool visit(const Solution &solution) override {
+    std::unique_lock<std::mutex> lock(stream_.mutex_);
+    stream_.not_full_.wait(lock, [this]() {
+      return stream_.cancelled_ || stream_.queue_.size() < stream_.capacity_;
+    });
+    if (stream_.cancelled_)
+      return false;
+    stream_.queue_.push_back(solution);
+    stream_.not_empty_.notify_one();
+    return true;
+  }
+
+private:
+  SolutionStream &stream_;
+};
+
+SolutionStream::SolutionStream(const Dictionary &dictionary,
+                               const Options &options, size_t capacity)
+    : solver_(dictionary), capacity_(std::max<size_t>(capacity, 1)) {
+  thread_ = std::thread([this, options]() {
+    QueueVisitor visitor(*this);
+    StopReason reason = NOT_STOPPED;
+    std::exception_ptr error;
+    try {
+      reason = solver_.solve(options, visitor);
+    } catch (...) {
+      error = std::current_exception();
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_reason_ = reason;
+    error_ = error;
+    finished_ = true;
+    not_empty_.notify_all();
+  });
+}
+
+SolutionStream::~SolutionStream() {
+  cancel();
+  thread_.join();
+}
+
+size_t SolutionStream::next(Solution *out, size_t max) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  not_empty_.wait(lock, [this]() { return finished_ || !queue_.empty(); });
+  if (queue_.empty() && error_)
+    std::rethrow_exception(error_);
+  const size_t count = std::min(max, queue_.size());
+  std::copy(queue_.begin(), queue_.begin() + count, out);
+  queue_.erase(queue_.begin(), queue_.begin() + count);
+  not_full_.notify_all();
+  return count;
+}
+
+void SolutionStream::cancel() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  cancelled_ = true;
+  queue_.clear();
+  not_full_.notify_all();
+}
+
+} // namespace five_words
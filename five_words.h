@@ -0,0 +1,367 @@
+// This program is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+// for more details.
+
+// You should have received a copy of the GNU General Public License along
+// with this program. If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef FIVE_WORDS_H
+#define FIVE_WORDS_H
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+
+#include "large_table.h"
+
+struct PerfSample;
+
+namespace five_words {
+
+constexpr int WORD_LENGTH = 5;
+constexpr int WORDS_PER_SOLUTION = 5;
+// Letters a to z
+constexpr int ALPHABET_SIZE = 26;
+
+// The ids (see Dictionary) of the words making up one solution
+using Solution = std::array<uint32_t, WORDS_PER_SOLUTION>;
+
+// Why a search stopped before looking at everything, if it did
+enum StopReason : int {
+  NOT_STOPPED = 0,
+  LIMIT_REACHED,
+  DEADLINE_PASSED,
+  VISITOR_STOPPED
+};
+
+// Read the word list in filename, one word per line, with any surrounding
+// whitespace trimmed, or standard input if filename is "-". The file may be
+// gzip or zstd compressed (see word_input.h). Returns false if the file
+// couldn't be opened or decompressed, and read_error() in word_input.h says
+// why.
+bool read_word_list(const std::string &filename,
+                    std::vector<std::string> &word_list);
+// Same, for a word list that's already open
+void read_word_list(std::istream &in, std::vector<std::string> &word_list);
+// Read a word list with an optional score after each word (e.g. how common
+// it is), separated by whitespace, into word_list and scores. Words without a
+// score get 0.
+bool read_scored_word_list(const std::string &filename,
+                           std::vector<std::string> &word_list,
+                           std::vector<double> &scores);
+
+// The words of a word list that can be part of a solution, i.e. five lower
+// case letters a to z long with no repeated letters, keeping only the first
+// word for each set of letters. Each of these gets an id, from 0 up to
+// size() - 1. See AlphabetDictionary for other alphabets.
+class Dictionary {
+public:
+  Dictionary() = default;
+  explicit Dictionary(const std::vector<std::string> &word_list);
+
+  size_t size() const { return words_.size(); }
+  const std::string &word(uint32_t id) const { return words_[id]; }
+  // Bit n is set if the word contains the letter 'a' + n
+  uint32_t bitmap(uint32_t id) const { return bitmaps_[id]; }
+
+  // Ids are assigned in blocks by letter; ids from boundaries()[n] up to (but
+  // not including) boundaries()[n + 1] all contain the letter(s) in
+  // letter_bitmaps()[n], with 0 standing for the catch-all last block
+  const std::vector<uint32_t> &bitmaps() const { return bitmaps_; }
+  const std::vector<size_t> &boundaries() const { return boundaries_; }
+  const std::vector<uint32_t> &letter_bitmaps() const {
+    return letter_bitmaps_;
+  }
+
+private:
+  friend bool read_dictionary(const std::string &filename,
+                              Dictionary &dictionary, size_t &lines,
+                              int threads);
+
+  // The letters of the blocks, with a catch-all for the last
+  static std::vector<uint32_t> block_letter_bitmaps();
+  // Put the blocks of bitmaps and words together
+  void assemble(const std::vector<std::vector<uint32_t>> &word_bitmaps_letters,
+                const std::vector<std::vector<std::string>>
+                    &unique_words_letters);
+
+  std::vector<uint32_t> bitmaps_;
+  std::vector<std::string> words_;
+  std::vector<size_t> boundaries_;
+  std::vector<uint32_t> letter_bitmaps_;
+};
+
+// Read the word list in filename straight into dictionary, the same as
+// read_word_list and the Dictionary constructor but quicker for big lists:
+// the file is mapped and split at newlines into a piece per thread, which
+// parses and filters its lines into blocks of its own, and then the blocks
+// are merged in parallel. lines is set to how many lines were read. A
+// compressed file, standard input or a pipe is read the usual way, once.
+// threads is the size of the OpenMP team (0 for the OpenMP default). Returns
+// false if the file couldn't be opened or decompressed, as read_word_list.
+bool read_dictionary(const std::string &filename, Dictionary &dictionary,
+                     size_t &lines, int threads = 0);
+
+// Knobs and optional instrumentation for Solver::solve
+struct Options {
+  // Stop after this many solutions (0 for no limit). The search only counts
+  // as stopped by the limit if there turned out to be more than that.
+  size_t limit = 0;
+  // Stop once deadline has passed
+  bool has_deadline = false;
+  std::chrono::steady_clock::time_point deadline;
+  // Size of the OpenMP team (0 for the OpenMP default)
+  int threads = 0;
+  // Skip every word using any of these letters (bit n for 'a' + n)
+  uint32_t excluded_letters = 0;
+  // If not null, only look for solutions whose first word (the one with the
+  // lowest id) is one of these, e.g. to split a search up between processes
+  const std::vector<uint32_t> *first_words = nullptr;
+  // Carry on with the memo from the last solve, or from load_memo(), rather
+  // than starting afresh. Only valid if that was on the same dictionary.
+  bool reuse_memo = false;
+  // If not null, every thread counts hardware events over its share of the
+  // work and the totals are added to this
+  PerfSample *events = nullptr;
+  // If not null, filled in with the seconds each thread spent working
+  std::vector<double> *thread_busy_seconds = nullptr;
+};
+
+// Receives solutions as they are found
+class Visitor {
+public:
+  virtual ~Visitor() {}
+
+  // Called once per solution, from several threads at once, so this has to be
+  // thread safe. Solver gives the ids of each in increasing order. Return
+  // false to stop the search.
+  virtual bool visit(const Solution &solution) = 0;
+
+  // Called once every solution with the given first word (the one with the
+  // lowest id) has been visited, unless the search was stopped
+  virtual void finished_first_word(uint32_t /*id*/) {}
+};
+
+// Which word, if any, has each set of exactly word_length letters from an
+// alphabet of alphabet_size letters (at most 32), e.g. five of a to z. The
+// sets are numbered densely by their rank among all such sets in the
+// combinatorial number system, so there are C(26, 5) = 65,780 of them for
+// five-letter words. A bitset over the ranks, 8KB for those, says which sets
+// have a word, and a table gives that word's id. Once all but one word of a
+// solution is fixed, the last has to be one of the word_length letter
+// subsets of the letters left, so it can be found with a few probes here
+// rather than a scan through the candidates. On the lists measured so far
+// the search takes the same time either way, within noise, since few
+// candidates are left to scan by then. make check-closing-words checks it
+// against a scan.
+class ClosingWords {
+public:
+  static constexpr uint32_t NO_WORD = 0xffffffff;
+
+  ClosingWords(int alphabet_size = ALPHABET_SIZE,
+               int word_length = WORD_LENGTH);
+
+  // Index the word with id n by bitmaps[n], for every n. Bitmaps without
+  // word_length letters are skipped, as are any after the first for a set.
+  void assign(const std::vector<uint32_t> &bitmaps);
+
+  // The rank of a set of word_length letters
+  uint32_t rank(uint32_t letters) const {
+    uint32_t rank = 0;
+    for (int k = 1; letters != 0; k++, letters &= letters - 1)
+      rank += choose_[__builtin_ctz(letters)][k];
+    return rank;
+  }
+
+  // The id of the word with exactly these letters, or NO_WORD
+  uint32_t find(uint32_t letters) const {
+    const uint32_t r = rank(letters);
+    return (present_[r / 64] >> (r % 64)) & 1 ? ids_[r] : NO_WORD;
+  }
+
+  // Call visit with the id of every word using only letters from
+  // letters_left
+  template <typename Visit>
+  void for_each_word(uint32_t letters_left, Visit &&visit) const {
+    const int spare = __builtin_popcount(letters_left) - word_length_;
+    if (spare == 1)
+      drop_one_letter(letters_left, visit);
+    else if (spare >= 0)
+      drop_letters(letters_left, letters_left, spare, visit);
+  }
+
+private:
+  // The usual case, with one letter too many: the rank without the letter at
+  // position m is the sum over the letters before it as they are plus the
+  // letters after it moved down a place, so all of them come from one pass
+  template <typename Visit>
+  void drop_one_letter(uint32_t letters, Visit &visit) const {
+    int positions[32];
+    int count = 0;
+    for (uint32_t rest = letters; rest != 0; rest &= rest - 1)
+      positions[count++] = __builtin_ctz(rest);
+    // Everything after position m, moved down
+    uint32_t after[33];
+    after[count] = 0;
+    for (int m = count - 1; m > 0; m--)
+      after[m] = after[m + 1] + choose_[positions[m]][m];
+    uint32_t before = 0;
+    for (int m = 0; m < count; m++) {
+      const uint32_t r = before + after[m + 1];
+      if ((present_[r / 64] >> (r % 64)) & 1)
+        visit(ids_[r]);
+      if (m + 1 < count)
+        before += choose_[positions[m]][m + 1];
+    }
+  }
+
+  // Every way of taking spare of the letters in droppable out of letters
+  template <typename Visit>
+  void drop_letters(uint32_t letters, uint32_t droppable, int spare,
+                    Visit &visit) const {
+    if (spare == 0) {
+      const uint32_t id = find(letters);
+      if (id != NO_WORD)
+        visit(id);
+      return;
+    }
+    for (; droppable != 0; droppable &= droppable - 1) {
+      const uint32_t letter = droppable & (~droppable + 1);
+      // Only drop letters after this one from here on, so each subset comes
+      // up once
+      drop_letters(letters ^ letter, droppable & ~(letter | (letter - 1)),
+                   spare - 1, visit);
+    }
+  }
+
+  int word_length_;
+  // choose_[n][k] is C(n, k)
+  std::vector<std::vector<uint32_t>> choose_;
+  std::vector<uint64_t> present_;
+  std::vector<uint32_t> ids_;
+};
+
+// Finds every set of five words in a Dictionary with no letters in common. A
+// Solver owns the (large) tables used during the search and reuses them from
+// one solve to the next, even across dictionaries, so it's cheap to solve
+// repeatedly, but only one solve may run on it at a time.
+class Solver {
+public:
+  Solver();
+  explicit Solver(const Dictionary &dictionary);
+
+  // Solve the dictionary the Solver was constructed with
+  StopReason solve(const Options &options, Visitor &visitor);
+  // Solve some other dictionary, which only has to live until this returns.
+  // Anything thrown on one of the search threads (by visitor, say) stops the
+  // search and is rethrown here.
+  StopReason solve(const Dictionary &dictionary, const Options &options,
+                   Visitor &visitor);
+
+  // The same search a pair of first words at a time, for a caller driving it
+  // itself (see five_words_generator.h): begin on dictionary, which has to
+  // outlive the pairs, then add every solution whose two lowest ids are i
+  // and j to found, nothing if they don't go together. Honors excluded_letters
+  // and reuse_memo in options.
+  void begin_pairs(const Dictionary &dictionary, const Options &options);
+  void solve_pair(uint32_t i, uint32_t j, std::vector<Solution> &found);
+
+  // The memo table of word pairs known not to lead to a solution
+  const LargeTable &memo_table() const { return known_bad_ij_.table(); }
+
+  // Copy the memo as it stands out as a bitset of 2^26 bits, e.g. to save
+  // for a later run, or replace it with such a copy. The copy may be taken
+  // while a solve is running.
+  void save_memo(std::vector<uint64_t> &bits) const;
+  void load_memo(const std::vector<uint64_t> &bits);
+
+private:
+  const Dictionary *dictionary_ = nullptr;
+  EpochBitset known_bad_ij_;
+  ClosingWords closing_words_;
+  // For solve_pair: what begin_pairs was given, the letters that may be
+  // used, and room for the candidates
+  const Dictionary *pairs_dictionary_ = nullptr;
+  uint32_t pairs_letters_ = 0;
+  std::vector<uint32_t> candidate_bitmaps_;
+  std::vector<uint32_t> candidate_ids_;
+};
+
+// Split the search of dictionary into shards pieces by first word (see
+// Options::first_words), returning the first words of piece shard, from 0 to
+// shards - 1. Early words have far more partners than late ones, so rather
+// than ranges of ids the pieces are balanced on an estimate of the work for
+// each word. Deterministic, so separate processes agree on the split.
+std::vector<uint32_t> shard_first_words(const Dictionary &dictionary,
+                                        int shard, int shards);
+
+// Find only the solutions of dictionary that use at least one of the words in
+// seeds (by id), each once, with its ids in ascending order. This is a search
+// per seed over the words it has no letters in common with, so for a handful
+// of seeds it's far quicker than a full solve. Honors options like
+// Solver::solve, apart from the instrumentation, and likewise rethrows
+// anything thrown on one of the search threads.
+StopReason solve_containing(const Dictionary &dictionary,
+                            const std::vector<uint32_t> &seeds,
+                            const Options &options, Visitor &visitor);
+
+// Runs a solve on a background thread and hands the solutions over in batches,
+// for consumers that want to pull results rather than have them pushed. The
+// solver threads wait once capacity solutions are queued up, so the search
+// only gets as far ahead of the consumer as that.
+class SolutionStream {
+public:
+  SolutionStream(const Dictionary &dictionary, const Options &options,
+                 size_t capacity = 4096);
+  // Stops the search if it's still going
+  ~SolutionStream();
+
+  SolutionStream(const SolutionStream &) = delete;
+  SolutionStream &operator=(const SolutionStream &) = delete;
+
+  // Move up to max solutions into out, waiting for at least one unless the
+  // search is over. Returns 0 once every solution has been handed over, or
+  // rethrows what the search threw once the solutions found before that have.
+  size_t next(Solution *out, size_t max);
+
+  // Stop the search, dropping anything not yet handed over
+  void cancel();
+
+  // Why the search stopped, once next() has returned 0
+  StopReason stop_reason() const { return stop_reason_; }
+
+private:
+  class QueueVisitor;
+
+  Solver solver_;
+  size_t capacity_;
+  std::mutex mutex_;
+  std::condition_variable not_empty_;
+  std::condition_variable not_full_;
+  std::deque<Solution> queue_;
+  bool finished_ = false;
+  bool cancelled_ = false;
+  StopReason stop_reason_ = NOT_STOPPED;
+  std::exception_ptr error_;
+  std::thread thread_;
+};
+
+} // namespace five_words
+
+#endif
@@ -0,0 +1,178 @@
+// This program is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+// for more details.
+
+// You should have received a copy of the GNU General Public License along
+// with this program. If not, see <https://www.gnu.org/licenses/>.
+
+// Lazy, pull-based enumeration of solutions with C++20 coroutines:
+//
+//   for (const auto &solution : five_words::solutions(dictionary, options))
+//     if (good_enough(solution))
+//       break;
+//
+// Unlike the rest of the library this needs C++20, so it's header only and
+// the library itself can still be built as C++11.
+
+#ifndef FIVE_WORDS_GENERATOR_H
+#define FIVE_WORDS_GENERATOR_H
+
+#if !defined(__cpp_impl_coroutine)
+#error "five_words_generator.h needs C++20 coroutines"
+#endif
+
+#include <chrono>
+#include <coroutine>
+#include <exception>
+#include <iterator>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "five_words.h"
+
+namespace five_words {
+
+// A minimal std::generator (C++23): an input range whose elements are produced
+// by a coroutine, one co_yield at a time, as the range is iterated.
+template <typename T> class Generator {
+public:
+  struct promise_type {
+    const T *current = nullptr;
+    std::exception_ptr exception;
+
+    Generator get_return_object() {
+      return Generator(
+          std::coroutine_handle<promise_type>::from_promise(*this));
+    }
+    std::suspend_always initial_suspend() noexcept { return {}; }
+    std::suspend_always final_suspend() noexcept { return {}; }
+    std::suspend_always yield_value(const T &value) noexcept {
+      current = std::addressof(value);
+      return {};
+    }
+    void return_void() noexcept {}
+    void unhandled_exception() { exception = std::current_exception(); }
+  };
+
+  class iterator {
+  public:
+    using iterator_category = std::input_iterator_tag;
+    using value_type = T;
+    using difference_type = std::ptrdiff_t;
+
+    const T &operator*() const { return *handle_.promise().current; }
+    iterator &operator++() {
+      advance(handle_);
+      return *this;
+    }
+    void operator++(int) { ++*this; }
+    bool operator==(std::default_sentinel_t) const { return handle_.done(); }
+
+  private:
+    friend class Generator;
+    explicit iterator(std::coroutine_handle<promise_type> handle)
+        : handle_(handle) {}
+    std::coroutine_handle<promise_type> handle_;
+  };
+
+  Generator(Generator &&other) noexcept
+      : handle_(std::exchange(other.handle_, nullptr)) {}
+  Generator &operator=(Generator other) noexcept {
+    std::swap(handle_, other.handle_);
+    return *this;
+  }
+  // Destroying the generator part way through destroys the coroutine's
+  // locals, which is how breaking out of a loop stops the search
+  ~Generator() {
+    if (handle_)
+      handle_.destroy();
+  }
+
+  // The coroutine doesn't start until the first element is asked for
+  iterator begin() {
+    advance(handle_);
+    return iterator(handle_);
+  }
+  std::default_sentinel_t end() const { return {}; }
+
+private:
+  explicit Generator(std::coroutine_handle<promise_type> handle)
+      : handle_(handle) {}
+
+  static void advance(std::coroutine_handle<promise_type> handle) {
+    handle.resume();
+    if (handle.promise().exception)
+      std::rethrow_exception(handle.promise().exception);
+  }
+
+  std::coroutine_handle<promise_type> handle_;
+};
+
+// Enumerate solutions on the calling thread, doing only as much of the search
+// as it takes to produce each one. This is Solver::solve's search, stepped
+// through a pair of first words at a time with Solver::solve_pair, suspending
+// at every solution found, so stopping after the first few costs no more than
+// finding them and their pair's. Honors the limit, deadline and excluded
+// letters in options; dictionary must outlive the generator.
+inline Generator<Solution> solutions(const Dictionary &dictionary,
+                                     Options options = Options()) {
+  const size_t number_of_words = dictionary.size();
+  Solver solver;
+  solver.begin_pairs(dictionary, options);
+  std::vector<Solution> found;
+  size_t solutions_found = 0;
+
+  // Only look at the clock every so often, it's not free
+  constexpr unsigned DEADLINE_CHECK_INTERVAL = 1024;
+  unsigned until_deadline_check = DEADLINE_CHECK_INTERVAL;
+
+  for (size_t i = 0; i < number_of_words; i++) {
+    if ((dictionary.bitmap(i) & options.excluded_letters) != 0)
+      continue;
+    for (size_t j = i + 1; j < number_of_words; j++) {
+      if (options.has_deadline && --until_deadline_check == 0) {
+        if (std::chrono::steady_clock::now() >= options.deadline)
+          co_return;
+        until_deadline_check = DEADLINE_CHECK_INTERVAL;
+      }
+      if ((dictionary.bitmap(i) & dictionary.bitmap(j)) != 0)
+        continue;
+
+      // The pair is searched to the end before its solutions are handed out,
+      // so a consumer that stops part way through never leaves a wrong mark
+      // in the memo
+      found.clear();
+      solver.solve_pair(i, j, found);
+      for (const Solution &solution : found) {
+        co_yield solution;
+        if (options.limit != 0 && ++solutions_found >= options.limit)
+          co_return;
+      }
+    }
+  }
+}
+
+// Enumerate solutions found by a full parallel Solver running in the
+// background. The workers pause once batch solutions are waiting to be
+// consumed, and stop altogether when the generator is destroyed. Solutions
+// arrive in no particular order.
+inline Generator<Solution> parallel_solutions(const Dictionary &dictionary,
+                                              Options options = Options(),
+                                              size_t batch = 1024) {
+  SolutionStream stream(dictionary, options, batch);
+  std::vector<Solution> buffer(batch);
+  while (const size_t count = stream.next(buffer.data(), buffer.size()))
+    for (size_t i = 0; i < count; i++)
+      co_yield buffer[i];
+}
+
+} // namespace five_words
+
+#endif
@@ -12,250 +12,1457 @@
 // with this program. If not, see <https://www.gnu.org/licenses/>.
 
 #include <chrono>
+#include <climits>
+#include <cmath>
 #include <cstddef>
 #include <cstdint>
 
 #include <algorithm>
 #include <numeric>
 
+#include <mutex>
+
 #include <fstream>
 #include <iostream>
+#include <sstream>
 
-#include <bitset>
+#include <array>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <set>
 #include <string>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
-#ifdef __has_include
-#if __has_include(<bit>)
-#include <bit>
+#include "alphabet.h"
+#include "budget.h"
+#include "checkpoint.h"
+#include "cover.h"
+#include "five_words.h"
+#include "option_parsing.h"
+#include "perf_counters.h"
+#include "result_file.h"
+#include "text_output.h"
+#include "word_input.h"
+
+#ifdef _OPENMP
+#include <omp.h>
 #endif
+
+using namespace five_words;
+
+// Gathers up every solution so they can be printed once the search is done
+class CollectingVisitor : public Visitor {
+public:
+  bool visit(const Solution &solution) override {
+    std::lock_guard<std::mutex> lock(mutex_);
+    matches.push_back(solution);
+    return true;
+  }
+
+  std::vector<Solution> matches;
+
+private:
+  std::mutex mutex_;
+};
+
+static void write_matches(std::ostream &out, const Dictionary &dictionary,
+                          const std::vector<Solution> &matches) {
+  for (const auto &match : matches) {
+    for (const auto id : match) {
+      out << dictionary.word(id) << " ";
+    }
+    out << std::endl;
+  }
+}
+
+// Gathers up the solutions of each thread separately, without a lock, for
+// output grouped by their first two words. A thread sees every pair of a
+// first word before it moves on to another, so each thread's solutions come
+// in runs sharing their first two words.
+class PairCollectingVisitor : public Visitor {
+public:
+  explicit PairCollectingVisitor(int threads) : matches(threads) {}
+
+  bool visit(const Solution &solution) override {
+#ifdef _OPENMP
+    matches[omp_get_thread_num()].push_back(solution);
+#else
+    matches[0].push_back(solution);
 #endif
+    return true;
+  }
+
+  size_t size() const {
+    size_t size = 0;
+    for (const auto &thread_matches : matches)
+      size += thread_matches.size();
+    return size;
+  }
 
-constexpr int WORD_LENGTH = 5;
+  std::vector<std::vector<Solution>> matches;
+};
 
-int main(int argc, char *argv[]) {
+// Solutions, with the ids of each in increasing order as Solver finds them,
+// grouped by their first two words. The lists added are split into runs
+// sharing those, and only the runs are sorted, then the handful of
+// solutions of each pair, rather than every solution.
+class PairGroups {
+public:
+  void add(const std::vector<Solution> &matches) {
+    for (size_t begin = 0; begin < matches.size();) {
+      size_t end = begin + 1;
+      while (end < matches.size() && matches[end][0] == matches[begin][0] &&
+             matches[end][1] == matches[begin][1])
+        end++;
+      runs_.push_back(std::make_pair(&matches[begin], &matches[end]));
+      begin = end;
+    }
+  }
+
+  // Call each with the solutions of every pair in turn, sorted, the pairs in
+  // order too
+  template <typename Each> void for_each_pair(Each each) {
+    std::stable_sort(runs_.begin(), runs_.end(),
+                     [](const Run &a, const Run &b) {
+                       return std::make_pair((*a.first)[0], (*a.first)[1]) <
+                              std::make_pair((*b.first)[0], (*b.first)[1]);
+                     });
+    std::vector<Solution> pair;
+    for (size_t begin = 0; begin < runs_.size();) {
+      const Solution &first = *runs_[begin].first;
+      pair.clear();
+      size_t end = begin;
+      for (; end < runs_.size() && (*runs_[end].first)[0] == first[0] &&
+             (*runs_[end].first)[1] == first[1];
+           end++)
+        pair.insert(pair.end(), runs_[end].first, runs_[end].second);
+      std::sort(pair.begin(), pair.end());
+      each(pair);
+      begin = end;
+    }
+  }
+
+private:
+  using Run = std::pair<const Solution *, const Solution *>;
+  std::vector<Run> runs_;
+};
+
+// Where the run of solutions from begin sharing their first depth + 1 words
+// ends
+static size_t branch_end(const std::vector<Solution> &sorted, size_t begin,
+                         int depth) {
+  size_t end = begin + 1;
+  while (end < sorted.size() &&
+         std::equal(sorted[begin].begin(), sorted[begin].begin() + depth + 1,
+                    sorted[end].begin()))
+    end++;
+  return end;
+}
+
+// Write the solutions grouped by their first two words, one line per pair,
+// e.g. "i j {a b c | a b d | ...}", so the text grows with the number of
+// pairs rather than five words for every solution
+static void write_match_tree(std::ostream &out, const Dictionary &dictionary,
+                             PairGroups &groups) {
+  groups.for_each_pair([&](const std::vector<Solution> &pair) {
+    out << dictionary.word(pair[0][0]) << " " << dictionary.word(pair[0][1])
+        << " {";
+    for (size_t n = 0; n < pair.size(); n++) {
+      if (n != 0)
+        out << " | ";
+      out << dictionary.word(pair[n][2]) << " "
+          << dictionary.word(pair[n][3]) << " "
+          << dictionary.word(pair[n][4]);
+    }
+    out << "}\n";
+  });
+  out << std::flush;
+}
+
+// Write sorted[begin, end), which share their first depth words, as a JSON
+// object keyed by the next word, down to an array of the last words
+static void write_json_branch(std::ostream &out, const Dictionary &dictionary,
+                              const std::vector<Solution> &sorted,
+                              size_t begin, size_t end, int depth) {
+  if (depth == WORDS_PER_SOLUTION - 1) {
+    out << "[";
+    for (size_t n = begin; n < end; n++)
+      out << (n == begin ? "\"" : ",\"") << dictionary.word(sorted[n][depth])
+          << "\"";
+    out << "]";
+    return;
+  }
+  out << "{";
+  for (size_t n = begin; n < end;) {
+    const size_t next = std::min(branch_end(sorted, n, depth), end);
+    out << (n == begin ? "\"" : ",\"") << dictionary.word(sorted[n][depth])
+        << "\":";
+    write_json_branch(out, dictionary, sorted, n, next, depth + 1);
+    n = next;
+  }
+  out << "}";
+}
+
+// Write the solutions as a trie in JSON, each word a key holding the words
+// that go with it, e.g. {"i": {"j": {"k": {"l": ["m", "n"]}}}}, a pair of
+// first words at a time
+static void write_match_json(std::ostream &out, const Dictionary &dictionary,
+                             PairGroups &groups) {
+  out << "{";
+  bool any = false;
+  uint32_t first_word = 0;
+  groups.for_each_pair([&](const std::vector<Solution> &pair) {
+    if (!any || pair[0][0] != first_word) {
+      out << (any ? "},\"" : "\"") << dictionary.word(pair[0][0]) << "\":{";
+      first_word = pair[0][0];
+    } else {
+      out << ",";
+    }
+    any = true;
+    out << "\"" << dictionary.word(pair[0][1]) << "\":";
+    write_json_branch(out, dictionary, pair, 0, pair.size(), 2);
+  });
+  out << (any ? "}}" : "}") << std::endl;
+}
+
+// Summary statistics over the timed iterations of one pipeline stage, in
+// milliseconds
+struct StageTimes {
+  const char *name;
+  std::vector<double> samples;
+
+  void print_json(std::ostream &out) const {
+    std::vector<double> sorted = samples;
+    std::sort(sorted.begin(), sorted.end());
+    const size_t n = sorted.size();
+    const double median =
+        n % 2 == 1 ? sorted[n / 2] : (sorted[n / 2 - 1] + sorted[n / 2]) / 2;
+    // Nearest rank
+    const double p95 = sorted[static_cast<size_t>(std::ceil(0.95 * n)) - 1];
+    out << "\"" << name << "\": {\"min_ms\": " << sorted.front()
+        << ", \"median_ms\": " << median << ", \"p95_ms\": " << p95 << "}";
+  }
+};
+
+// Run each stage of the pipeline warmup + iterations times on the given word
+// list, discarding the warmup runs, and print per-stage timings as JSON. The
+// output stage formats into memory so terminal speed doesn't factor in.
+static int run_benchmark(const char *filename, int iterations, int warmup) {
+  StageTimes read_times = {"read", {}};
+  StageTimes filter_times = {"filter", {}};
+  StageTimes search_times = {"search", {}};
+  StageTimes output_times = {"output", {}};
+
+  size_t number_of_words = 0, number_of_unique_words = 0,
+         number_of_matches = 0;
+
+  for (int iteration = 0; iteration < warmup + iterations; iteration++) {
+    const bool timed = iteration >= warmup;
+    const auto record = [timed](StageTimes &stage,
+                                std::chrono::steady_clock::time_point begin) {
+      if (timed)
+        stage.samples.push_back(
+            std::chrono::duration<double, std::milli>(
+                std::chrono::steady_clock::now() - begin)
+                .count());
+    };
+
+    auto stage_start = std::chrono::steady_clock::now();
+    std::vector<std::string> word_list;
+    if (!read_word_list(filename, word_list)) {
+      std::cerr << read_error() << std::endl;
+      return 2;
+    }
+    record(read_times, stage_start);
+
+    stage_start = std::chrono::steady_clock::now();
+    const Dictionary dictionary(word_list);
+    record(filter_times, stage_start);
+
+    // Setting up the solver's tables is part of what a fresh run pays for
+    stage_start = std::chrono::steady_clock::now();
+    Solver solver(dictionary);
+    CollectingVisitor visitor;
+    solver.solve(Options(), visitor);
+    record(search_times, stage_start);
+
+    stage_start = std::chrono::steady_clock::now();
+    std::string formatted;
+    format_solutions(dictionary, visitor.matches, formatted);
+    record(output_times, stage_start);
+
+    number_of_words = word_list.size();
+    number_of_unique_words = dictionary.size();
+    number_of_matches = visitor.matches.size();
+  }
+
+#ifdef _OPENMP
+  const int threads = omp_get_max_threads();
+#else
+  const int threads = 1;
+#endif
+
+  std::string escaped;
+  for (const char *c = filename; *c != '\0'; c++) {
+    if (*c == '"' || *c == '\\')
+      escaped += '\\';
+    escaped += *c;
+  }
+
+  std::cout << "{\"wordlist\": \"" << escaped << "\", \"threads\": " << threads
+            << ", \"iterations\": " << iterations << ", \"warmup\": " << warmup
+            << ", \"words\": " << number_of_words
+            << ", \"unique_words\": " << number_of_unique_words
+            << ", \"solutions\": " << number_of_matches << ", \"stages\": {";
+  read_times.print_json(std::cout);
+  std::cout << ", ";
+  filter_times.print_json(std::cout);
+  std::cout << ", ";
+  search_times.print_json(std::cout);
+  std::cout << ", ";
+  output_times.print_json(std::cout);
+  std::cout << "}}" << std::endl;
+  return 0;
+}
+
+// Repeat the search of dictionary with each of the given team sizes, in
+// order, reporting the time of each and its speedup and efficiency relative
+// to the first, and how evenly the work was spread over the threads.
+static void run_scaling(const Dictionary &dictionary,
+                        const std::vector<int> &thread_counts) {
+  Solver solver(dictionary);
+  double baseline_seconds = 0;
+  int baseline_threads = 0;
+
+  std::cout << "threads\tseconds\tspeedup\tefficiency\timbalance"
+            << std::endl;
+  for (const int threads : thread_counts) {
+    CollectingVisitor visitor;
+    std::vector<double> busy_seconds;
+    Options options;
+    options.threads = threads;
+    options.thread_busy_seconds = &busy_seconds;
+
+    const auto search_start = std::chrono::steady_clock::now();
+    solver.solve(options, visitor);
+    const double seconds = std::chrono::duration<double>(
+                               std::chrono::steady_clock::now() - search_start)
+                               .count();
+
+    if (baseline_threads == 0) {
+      baseline_seconds = seconds;
+      baseline_threads = threads;
+    }
+    const double speedup = baseline_seconds / seconds;
+    const double efficiency = speedup * baseline_threads / threads;
+    // Busy time of the slowest thread over that of the average one, 1 is
+    // perfectly balanced
+    const double mean_busy =
+        std::accumulate(busy_seconds.begin(), busy_seconds.end(), 0.0) /
+        busy_seconds.size();
+    const double imbalance =
+        *std::max_element(busy_seconds.begin(), busy_seconds.end()) /
+        mean_busy;
+
+    std::cout << threads << "\t" << seconds << "\t" << speedup << "\t"
+              << efficiency << "\t" << imbalance << std::endl;
+  }
+}
+
+// Dictionaries with fewer unique words than this are solved on a single thread
+// each, several at once, since a team of threads spends more time waiting on
+// each other than searching on lists this small
+constexpr size_t SMALL_DICTIONARY_WORDS = 2000;
+
+// One word list from a batch manifest, and what became of it
+struct BatchJob {
+  std::string wordlist;
+  std::string output;
+  Dictionary dictionary;
+  bool read = false;
+  // Why it couldn't be read, if it couldn't
+  std::string read_error;
+  size_t solutions = 0;
+  double search_seconds = 0;
+  // Whether the solutions made it into output
+  bool written = false;
+};
+
+static void solve_batch_job(Solver &solver, int threads, BatchJob &job) {
+  CollectingVisitor visitor;
+  Options options;
+  options.threads = threads;
+
+  const auto search_start = std::chrono::steady_clock::now();
+  solver.solve(job.dictionary, options, visitor);
+  job.search_seconds = std::chrono::duration<double>(
+                           std::chrono::steady_clock::now() - search_start)
+                           .count();
+
+  job.solutions = visitor.matches.size();
+  std::ofstream out(job.output);
+  if (!out.is_open())
+    return;
+  write_matches(out, job.dictionary, visitor.matches);
+  out.close();
+  job.written = !out.fail();
+}
+
+// Solve every word list named in manifest, one per line, optionally followed
+// by where to write its solutions (by default the word list's name with
+// .solutions appended). Big lists are solved one after another by every
+// thread, sharing one set of tables; small ones are spread over the threads,
+// each with its own tables. Either way the tables are only set up once.
+static int run_batch(const char *manifest) {
   const auto start_time = std::chrono::steady_clock::now();
-  if (argc < 2) {
-    std::cerr << "Please provide wordlist filename!" << std::endl;
-    return 1;
+
+  std::ifstream manifest_file(manifest);
+  if (!manifest_file.is_open()) {
+    std::cerr << "Could not open file: " << manifest << std::endl;
+    return 2;
+  }
+  std::vector<BatchJob> jobs;
+  std::string line;
+  while (std::getline(manifest_file, line)) {
+    std::istringstream fields(line);
+    BatchJob job;
+    if (!(fields >> job.wordlist) || job.wordlist[0] == '#')
+      continue;
+    if (!(fields >> job.output))
+      job.output = job.wordlist + ".solutions";
+    jobs.push_back(std::move(job));
   }
 
-  // First, open the word list given on the command line and read in some words!
+#pragma omp parallel for schedule(dynamic)
+  for (size_t n = 0; n < jobs.size(); n++) {
+    std::vector<std::string> word_list;
+    jobs[n].read = read_word_list(jobs[n].wordlist, word_list);
+    jobs[n].read_error = read_error();
+    jobs[n].dictionary = Dictionary(word_list);
+  }
 
-  std::ifstream word_file(argv[1]);
-  std::vector<std::string> word_list;
+  std::vector<BatchJob *> big_jobs, small_jobs;
+  for (auto &job : jobs) {
+    if (!job.read)
+      std::cerr << job.read_error << std::endl;
+    else if (job.dictionary.size() < SMALL_DICTIONARY_WORDS)
+      small_jobs.push_back(&job);
+    else
+      big_jobs.push_back(&job);
+  }
+  // Start on the biggest of the small ones first so none is left running on
+  // its own at the end
+  std::sort(small_jobs.begin(), small_jobs.end(),
+            [](const BatchJob *a, const BatchJob *b) {
+              return a->dictionary.size() > b->dictionary.size();
+            });
 
-  if (word_file.is_open()) {
-    std::string line;
-    while (std::getline(word_file, line)) {
-      // Trim any leading or trailing whitespace
-      line.erase(line.begin(),
-                 std::find_if(line.begin(), line.end(), [](unsigned char c) {
-                   return !std::isspace(c);
-                 }));
-      line.erase(std::find_if(line.rbegin(), line.rend(),
-                              [](unsigned char c) { return !std::isspace(c); })
-                     .base(),
-                 line.end());
-
-      word_list.push_back(line);
+  if (!big_jobs.empty()) {
+    Solver solver;
+    for (auto *job : big_jobs)
+      solve_batch_job(solver, 0, *job);
+  }
+
+#pragma omp parallel if (!small_jobs.empty())
+  {
+    std::unique_ptr<Solver> solver;
+#pragma omp for schedule(dynamic)
+    for (size_t n = 0; n < small_jobs.size(); n++) {
+      if (!solver)
+        solver.reset(new Solver());
+      solve_batch_job(*solver, 1, *small_jobs[n]);
     }
-    word_file.close();
-  } else {
-    std::cerr << "Could not open file: " << argv[1] << std::endl;
+  }
+
+  double search_seconds = 0;
+  size_t solved = 0;
+  for (const auto &job : jobs) {
+    if (!job.read)
+      continue;
+    if (!job.written) {
+      std::cerr << "Could not write file: " << job.output << std::endl;
+      continue;
+    }
+    std::cout << job.wordlist << ": " << job.dictionary.size()
+              << " unique words, " << job.solutions << " solutions in "
+              << job.search_seconds << " seconds, written to " << job.output
+              << std::endl;
+    search_seconds += job.search_seconds;
+    solved++;
+  }
+
+  const double elapsed = std::chrono::duration<double>(
+                             std::chrono::steady_clock::now() - start_time)
+                             .count();
+  std::cout << "Solved " << solved << " of " << jobs.size()
+            << " word lists in " << elapsed << " seconds (" << search_seconds
+            << " seconds searching)" << std::endl;
+  return solved == jobs.size() ? 0 : 2;
+}
+
+// Letters of word as a bitmap, or 0 if it isn't a lower case word of the
+// right length
+static uint32_t word_bitmap(const std::string &word) {
+  if (word.length() != WORD_LENGTH)
+    return 0;
+  uint32_t bitmap = 0;
+  for (const char c : word) {
+    if (c < 'a' || c > 'z')
+      return 0;
+    bitmap |= 1 << (c - 'a');
+  }
+  return bitmap;
+}
+
+// Split a line of output into the words of a solution, returning false if it
+// isn't one. Nothing else a run prints looks like five words, so the whole
+// output can be handed to anything reading solutions back in.
+static bool
+parse_solution(const std::string &line,
+               std::array<std::string, WORDS_PER_SOLUTION> &words) {
+  std::istringstream in(line);
+  for (auto &word : words)
+    if (!(in >> word) || word_bitmap(word) == 0)
+      return false;
+  std::string extra;
+  return !(in >> extra);
+}
+
+// Bring the solutions in previous, as printed by an earlier run on filename,
+// up to date with the words in added and removed. Previous solutions are kept
+// if every word in them (or an anagram) survived, spelled as they were where
+// that word is still in the list, and the only search is for solutions using
+// at least one word whose letters are new to the list. The limit and deadline
+// in options bound that search; excluded letters rule out kept solutions too.
+static int run_incremental(const char *filename, const char *previous,
+                           const char *added, const char *removed,
+                           const Options &options) {
+  const auto start_time = std::chrono::steady_clock::now();
+
+  std::vector<std::string> word_list, added_words, removed_words;
+  for (const auto &file :
+       {std::make_pair(filename, &word_list),
+        std::make_pair(added, &added_words),
+        std::make_pair(removed, &removed_words)}) {
+    if (file.first != nullptr && !read_word_list(file.first, *file.second)) {
+      std::cerr << read_error() << std::endl;
+      return 2;
+    }
+  }
+  std::ifstream previous_file(previous);
+  if (!previous_file.is_open()) {
+    std::cerr << "Could not open file: " << previous << std::endl;
     return 2;
   }
 
-  std::cout << "Read " << word_list.size() << " words from " << argv[1]
-            << std::endl;
+  const Dictionary old_dictionary(word_list);
+  const std::unordered_set<uint32_t> old_bitmaps(
+      old_dictionary.bitmaps().begin(), old_dictionary.bitmaps().end());
 
-  // Next, filter the word list down to the words we actually care about (i.e.
-  // words of length five with no duplicate letters)
-
-  // Create several mutually exclusive lists of words, the first for words with
-  // an 'e', the next for words with a 't' but no 'e', the next for words with
-  // an 'a' but no 't' or 'e', and so on, with an extra list at the end that's a
-  // catch all for everything else. This allows us to more quickly prune the
-  // search space later on since we can disregard the entire block if the
-  // corresponding letter is present in the combined bitmap.
-
-  // The number of individual letter lists to make is a potential trade off,
-  // here are a few, but, empirically, the longest one 'etaoinshrldu' seems to
-  // be best.
-  // std::vector<char> letters = {'e'};
-  // std::vector<char> letters = {'e', 't', 'a', 'o', 'i', 'n'};
-  std::vector<char> letters = {'e', 't', 'a', 'o', 'i', 'n',
-                               's', 'h', 'r', 'l', 'd', 'u'};
-  std::vector<uint32_t> letter_bitmaps;
-  std::transform(letters.cbegin(), letters.cend(),
-                 std::back_inserter(letter_bitmaps),
-                 [](char letter) { return 1 << (letter - 'a'); });
-  letter_bitmaps.push_back(0xffff); // At the end, match against everything left
-  std::vector<std::vector<uint32_t>> word_bitmaps_letters(
-      letter_bitmaps.size());
-  std::vector<std::vector<std::string>> unique_words_letters(
-      letter_bitmaps.size());
-
-  for (const auto &word : word_list) {
-    if (word.length() != WORD_LENGTH)
+  const std::unordered_set<std::string> removed_set(removed_words.begin(),
+                                                    removed_words.end());
+  word_list.erase(std::remove_if(word_list.begin(), word_list.end(),
+                                 [&removed_set](const std::string &word) {
+                                   return removed_set.count(word) != 0;
+                                 }),
+                  word_list.end());
+  word_list.insert(word_list.end(), added_words.begin(), added_words.end());
+  const Dictionary dictionary(word_list);
+  const std::unordered_set<std::string> present(word_list.begin(),
+                                                word_list.end());
+
+  std::unordered_map<uint32_t, uint32_t> ids;
+  std::vector<uint32_t> seeds;
+  for (uint32_t id = 0; id < dictionary.size(); id++) {
+    ids[dictionary.bitmap(id)] = id;
+    if (old_bitmaps.count(dictionary.bitmap(id)) == 0)
+      seeds.push_back(id);
+  }
+
+  // Kept solutions as they're to be printed, each word in id order
+  std::vector<std::array<std::string, WORDS_PER_SOLUTION>> kept;
+  size_t number_of_previous = 0;
+  std::string line;
+  std::array<std::string, WORDS_PER_SOLUTION> words;
+  while (std::getline(previous_file, line)) {
+    if (!parse_solution(line, words))
       continue;
+    number_of_previous++;
 
-    // Use a bitmap to represent a set for performance. Since there are only 26
-    // possible letters (assumes that all letters are lower case ASCII), the 32
-    // bits of a uint32_t are sufficient. Set the bit corresponding to the index
-    // of each character (e.g. 'a' = 0, 'b' = 1, ...).
-    const uint32_t bitmap = std::accumulate(
-        word.begin(), word.end(), 0,
-        [](uint32_t bitmap, const char c) { return bitmap |= 1 << (c - 'a'); });
-
-    // Get the number of bits set in the bitmap
-#ifdef __cpp_lib_bitops
-    // C++20 only feature
-    const int bitcount = std::popcount(bitmap);
-#else
-    const std::bitset<8 * sizeof(uint32_t)> b(bitmap);
-    const int bitcount = b.count();
-#endif
+    std::array<std::pair<uint32_t, std::string>, WORDS_PER_SOLUTION> spelled;
+    bool keep = true;
+    for (int n = 0; n < WORDS_PER_SOLUTION && keep; n++) {
+      const uint32_t bitmap = word_bitmap(words[n]);
+      const auto id = ids.find(bitmap);
+      keep = id != ids.end() && (bitmap & options.excluded_letters) == 0;
+      if (keep)
+        spelled[n] = std::make_pair(id->second,
+                                    present.count(words[n]) != 0
+                                        ? words[n]
+                                        : dictionary.word(id->second));
+    }
+    if (keep) {
+      std::sort(spelled.begin(), spelled.end());
+      kept.emplace_back();
+      for (int n = 0; n < WORDS_PER_SOLUTION; n++)
+        kept.back()[n] = spelled[n].second;
+    }
+  }
 
-    // If there are no duplicate characters, check which collection to add it to
-    if (bitcount == WORD_LENGTH) {
-      for (size_t i = 0; i < letter_bitmaps.size(); i++) {
-        // If the current bitmap contains the given letter
-        if ((bitmap & letter_bitmaps[i]) != 0) {
-          // If we haven't seen this bitmap before
-          if (word_bitmaps_letters[i].end() ==
-              std::find(word_bitmaps_letters[i].begin(),
-                        word_bitmaps_letters[i].end(), bitmap)) {
-            word_bitmaps_letters[i].push_back(bitmap);
-            unique_words_letters[i].push_back(word);
-          }
-          break;
-        }
-      }
+  CollectingVisitor visitor;
+  const StopReason stop_reason =
+      solve_containing(dictionary, seeds, options, visitor);
+
+  std::cout << "Found " << dictionary.size() << " unique words, "
+            << seeds.size() << " of them new" << std::endl
+            << "Kept " << kept.size() << " of " << number_of_previous
+            << " previous solutions" << std::endl;
+  if (stop_reason == NOT_STOPPED)
+    std::cout << "Search complete" << std::endl;
+  else if (stop_reason != VISITOR_STOPPED)
+    std::cout << "Search truncated" << std::endl;
+  std::cout << "Damn, we had " << visitor.matches.size()
+            << " new successful finds, "
+            << kept.size() + visitor.matches.size() << " in all!"
+            << std::endl
+            << "Here they all are:" << std::endl;
+  for (const auto &solution : kept) {
+    for (const auto &word : solution)
+      std::cout << word << " ";
+    std::cout << std::endl;
+  }
+  write_matches(std::cout, dictionary, visitor.matches);
+
+  const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::steady_clock::now() - start_time);
+  std::cout << "DONE in " << elapsed.count() / 1000.0 << " seconds"
+            << std::endl;
+  return 0;
+}
+
+// Combine the solutions in the outputs of several runs (e.g. the shards of
+// one search) into a single canonical list: the words of each solution in
+// alphabetical order, and the solutions sorted, without duplicates
+static int run_merge(const std::vector<const char *> &filenames) {
+  std::set<std::string> merged;
+  size_t number_read = 0;
+  for (const char *filename : filenames) {
+    std::ifstream in(filename);
+    if (!in.is_open()) {
+      std::cerr << "Could not open file: " << filename << std::endl;
+      return 2;
+    }
+    std::string line;
+    std::array<std::string, WORDS_PER_SOLUTION> words;
+    while (std::getline(in, line)) {
+      if (!parse_solution(line, words))
+        continue;
+      std::sort(words.begin(), words.end());
+      std::string solution;
+      for (const auto &word : words)
+        solution += word + " ";
+      merged.insert(solution);
+      number_read++;
     }
   }
 
-  const size_t number_of_words = std::accumulate(
-      word_bitmaps_letters.cbegin(), word_bitmaps_letters.cend(), 0,
-      [](size_t sum, const std::vector<uint32_t> &vec) {
-        return sum + vec.size();
+  std::cout << "Read " << number_read << " solutions from " << filenames.size()
+            << " files" << std::endl
+            << "Damn, we had " << merged.size() << " successful finds!"
+            << std::endl
+            << "Here they all are:" << std::endl;
+  for (const auto &solution : merged)
+    std::cout << solution << "\n";
+  std::cout << std::flush;
+  return 0;
+}
+
+// Print the solutions in a binary result file (see result_file.h) as text
+static int run_dump(const char *filename) {
+  ResultFile results;
+  if (!results.open(filename)) {
+    std::cerr << "Could not read result file: " << filename << std::endl;
+    return 2;
+  }
+
+  std::cout << "Read " << results.size() << " solutions of "
+            << results.words() << " words from " << filename << std::endl
+            << "Damn, we had " << results.size() << " successful finds!"
+            << std::endl
+            << "Here they all are:" << std::endl;
+  for (size_t n = 0; n < results.size(); n++) {
+    for (const auto id : results.solution(n))
+      std::cout << results.word(id) << " ";
+    std::cout << "\n";
+  }
+  std::cout << std::flush;
+  return 0;
+}
+
+// Gathers up every set found by find_covers
+class CollectingCoverVisitor : public CoverVisitor {
+public:
+  bool visit(const Cover &cover) override {
+    std::lock_guard<std::mutex> lock(mutex_);
+    covers.push_back(cover);
+    return true;
+  }
+
+  std::vector<Cover> covers;
+
+private:
+  std::mutex mutex_;
+};
+
+// The run of each mode besides the main one, timed from start to finish:
+// read the word list in filename (with a score after each word if scored),
+// build a dictionary from it, search that and print what was found. A mode
+// supplies only build, search and print. kind says what sort of unique words
+// the dictionary keeps, truncated what to say if the search stopped early and
+// heading (if any) what goes before the finds.
+template <typename ModeDictionary, typename Find>
+static int run_mode(
+    const char *filename, bool scored, const std::string &kind,
+    const std::function<ModeDictionary(const std::vector<std::string> &,
+                                       const std::vector<double> &)> &build,
+    const std::function<StopReason(const ModeDictionary &,
+                                   std::vector<Find> &)> &search,
+    const char *truncated, const char *heading,
+    const std::function<void(const ModeDictionary &,
+                             const std::vector<Find> &)> &print) {
+  const auto start_time = std::chrono::steady_clock::now();
+
+  std::vector<std::string> word_list;
+  std::vector<double> scores;
+  if (!(scored ? read_scored_word_list(filename, word_list, scores)
+               : read_word_list(filename, word_list))) {
+    std::cerr << read_error() << std::endl;
+    return 2;
+  }
+  std::cout << "Read " << word_list.size() << " words from " << filename
+            << std::endl;
+
+  const ModeDictionary dictionary = build(word_list, scores);
+  std::cout << "Found " << dictionary.size() << " unique words" << kind
+            << std::endl;
+
+  std::vector<Find> finds;
+  const StopReason stop_reason = search(dictionary, finds);
+  if (stop_reason == NOT_STOPPED)
+    std::cout << "Search complete" << std::endl;
+  else if (stop_reason != VISITOR_STOPPED)
+    std::cout << truncated << std::endl;
+
+  std::cout << "Damn, we had " << finds.size() << " successful finds!"
+            << std::endl;
+  if (heading != nullptr)
+    std::cout << heading << std::endl;
+  print(dictionary, finds);
+  std::cout << std::flush;
+
+  const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::steady_clock::now() - start_time);
+  std::cout << "DONE in " << elapsed.count() / 1000.0 << " seconds"
+            << std::endl;
+  return 0;
+}
+
+// Print each of finds on a line of its own, its words followed by spaces
+template <typename ModeDictionary, typename Ids>
+static void write_finds(const ModeDictionary &dictionary,
+                        const std::vector<Ids> &finds) {
+  for (const auto &ids : finds) {
+    for (const auto id : ids)
+      std::cout << dictionary.word(id) << " ";
+    std::cout << "\n";
+  }
+}
+
+// What min_length to max_length letter words are kept, for run_mode
+static std::string lengths_kind(int min_length, int max_length) {
+  return " of " + std::to_string(min_length) + " to " +
+         std::to_string(max_length) + " letters";
+}
+
+// Find sets of words from min_length to max_length letters long covering at
+// least goal.letters letters, instead of five five-letter words
+static int run_covers(const char *filename, int min_length, int max_length,
+                      const CoverGoal &goal, const Options &options) {
+  return run_mode<MixedDictionary, Cover>(
+      filename, false, lengths_kind(min_length, max_length),
+      [=](const std::vector<std::string> &word_list,
+          const std::vector<double> &) {
+        return MixedDictionary(word_list, min_length, max_length);
+      },
+      [&](const MixedDictionary &dictionary, std::vector<Cover> &covers) {
+        CollectingCoverVisitor visitor;
+        const StopReason stop_reason =
+            find_covers(dictionary, goal, options, visitor);
+        covers = std::move(visitor.covers);
+        return stop_reason;
+      },
+      "Search truncated", "Here they all are:",
+      write_finds<MixedDictionary, Cover>);
+}
+
+// Find the sets of at most max_words words covering the most letters, all of
+// the best ones or the top best
+static int run_max_coverage(const char *filename, int min_length,
+                            int max_length, int max_words, size_t top,
+                            const Options &options) {
+  typedef std::pair<int, Cover> Covering;
+  return run_mode<MixedDictionary, Covering>(
+      filename, false, lengths_kind(min_length, max_length),
+      [=](const std::vector<std::string> &word_list,
+          const std::vector<double> &) {
+        return MixedDictionary(word_list, min_length, max_length);
+      },
+      [&](const MixedDictionary &dictionary, std::vector<Covering> &best) {
+        return find_max_coverage(dictionary, max_words, top, options, best);
+      },
+      "Search truncated, these are the best found in time", nullptr,
+      [](const MixedDictionary &dictionary,
+         const std::vector<Covering> &best) {
+        for (size_t n = 0; n < best.size(); n++) {
+          if (n == 0 || best[n].first != best[n - 1].first)
+            std::cout << "Covering " << best[n].first << " letters:"
+                      << std::endl;
+          for (const auto id : best[n].second)
+            std::cout << dictionary.word(id) << " ";
+          std::cout << "\n";
+        }
       });
+}
 
-  std::vector<uint32_t> word_bitmaps;
-  std::vector<std::string> unique_words;
+// Find the top sets meeting goal with the highest total score, from a word
+// list with a score after each word
+static int run_top_covers(const char *filename, int min_length, int max_length,
+                          const CoverGoal &goal, size_t top,
+                          const Options &options) {
+  typedef std::pair<double, Cover> ScoredCover;
+  return run_mode<MixedDictionary, ScoredCover>(
+      filename, true, lengths_kind(min_length, max_length),
+      [=](const std::vector<std::string> &word_list,
+          const std::vector<double> &scores) {
+        return MixedDictionary(word_list, min_length, max_length, &scores);
+      },
+      [&](const MixedDictionary &dictionary, std::vector<ScoredCover> &best) {
+        return find_top_covers(dictionary, goal, top, options, best);
+      },
+      "Search truncated, these are the best found in time",
+      "Here are the best:",
+      [](const MixedDictionary &dictionary,
+         const std::vector<ScoredCover> &best) {
+        for (const auto &scored : best) {
+          for (const auto id : scored.second)
+            std::cout << dictionary.word(id) << " ";
+          std::cout << scored.first << "\n";
+        }
+      });
+}
 
-  word_bitmaps.reserve(number_of_words);
-  unique_words.reserve(number_of_words);
+// Solve a word list in some other alphabet, read from alphabet_file
+static int run_alphabet(const char *filename, const char *alphabet_file,
+                        const Options &options) {
+  Alphabet alphabet;
+  if (!read_alphabet(alphabet_file, alphabet)) {
+    std::cerr << "Could not read an alphabet of at most " << MAX_ALPHABET_SIZE
+              << " symbols from " << alphabet_file << std::endl;
+    return 2;
+  }
+
+  return run_mode<AlphabetDictionary, Solution>(
+      filename, false,
+      " over " + std::to_string(alphabet.size()) + " symbols",
+      [&](const std::vector<std::string> &word_list,
+          const std::vector<double> &) {
+        return AlphabetDictionary(word_list, alphabet);
+      },
+      [&](const AlphabetDictionary &dictionary,
+          std::vector<Solution> &matches) {
+        CollectingVisitor visitor;
+        const StopReason stop_reason = solve(dictionary, options, visitor);
+        matches = std::move(visitor.matches);
+        return stop_reason;
+      },
+      "Search truncated", "Here they all are:",
+      write_finds<AlphabetDictionary, Solution>);
+}
+
+// Find five words using no more of each letter than budget allows
+static int run_budget(const char *filename, const LetterBudget &budget,
+                      const Options &options) {
+  return run_mode<BudgetDictionary, Solution>(
+      filename, false, "",
+      [](const std::vector<std::string> &word_list,
+         const std::vector<double> &) { return BudgetDictionary(word_list); },
+      [&](const BudgetDictionary &dictionary, std::vector<Solution> &matches) {
+        CollectingVisitor visitor;
+        const StopReason stop_reason =
+            solve(dictionary, budget, options, visitor);
+        matches = std::move(visitor.matches);
+        return stop_reason;
+      },
+      "Search truncated", "Here they all are:",
+      write_finds<BudgetDictionary, Solution>);
+}
 
-  std::vector<size_t> word_bitmaps_boundaries;
+// Wall-clock time for each phase of a run, along with hardware event counts if
+// asked for
+class PhaseProfiler {
+public:
+  explicit PhaseProfiler(bool count_events)
+      : counters_(count_events ? new PerfCounters() : nullptr) {}
 
-  // Combine each individual letter list into one, saving the boundaries for
-  // later
-  for (size_t i = 0; i < word_bitmaps_letters.size(); i++) {
-    word_bitmaps_boundaries.push_back(word_bitmaps.size());
-    word_bitmaps.insert(word_bitmaps.end(), word_bitmaps_letters[i].begin(),
-                        word_bitmaps_letters[i].end());
-    unique_words.insert(unique_words.end(), unique_words_letters[i].begin(),
-                        unique_words_letters[i].end());
+  void begin() {
+    phase_start_ = std::chrono::steady_clock::now();
+    if (counters_)
+      counters_->start();
   }
-  word_bitmaps_boundaries.push_back(word_bitmaps.size());
 
-  // Reset this to 0 since we're looking for the opposite now, we want all words
-  // to match with the last section
-  letter_bitmaps[letter_bitmaps.size() - 1] = 0;
+  // Finish the phase started by the last begin(). Phases that run on several
+  // threads pass in the events counted across all of them, which replace the
+  // events counted on this one.
+  void end(const char *name, const PerfSample *thread_events = nullptr) {
+    Phase phase;
+    phase.name = name;
+    phase.milliseconds = std::chrono::duration<double, std::milli>(
+                             std::chrono::steady_clock::now() - phase_start_)
+                             .count();
+    if (counters_)
+      phase.events = counters_->stop();
+    if (thread_events != nullptr)
+      phase.events = *thread_events;
+    phases_.push_back(phase);
+  }
 
-  std::cout << "Found " << word_bitmaps.size() << " unique words" << std::endl;
+  bool counting_events() const { return counters_ != nullptr; }
 
-  // Finally, it's time to actually look for some words!
+  void print(std::ostream &out) const {
+    out << "Phase timings:" << std::endl;
+    if (counters_ && !counters_->available())
+      out << "  (hardware counters unavailable: " << counters_->error() << ")"
+          << std::endl;
+    for (const auto &phase : phases_) {
+      out << "  " << phase.name << ": " << phase.milliseconds << " ms";
+      if (counters_ && counters_->available())
+        out << ", " << phase.events.describe();
+      out << std::endl;
+    }
+  }
 
-  std::vector<std::vector<std::string>> matches;
+private:
+  struct Phase {
+    const char *name;
+    double milliseconds;
+    PerfSample events;
+  };
 
-  std::vector<uint32_t> candidate_bitmaps;
-  std::vector<size_t> candidate_indices;
+  std::unique_ptr<PerfCounters> counters_;
+  std::chrono::steady_clock::time_point phase_start_;
+  std::vector<Phase> phases_;
+};
 
-  std::vector<bool> known_bad_ij((1 << 26) - 1, false);
+// Parse the whole of text as k/n, for piece k of a search split into n, with
+// k from 0 to n - 1
+static bool parse_shard(const char *text, int &shard, int &shards) {
+  const std::string spec = text;
+  const size_t slash = spec.find('/');
+  if (slash == std::string::npos)
+    return false;
+  return parse_number(spec.substr(0, slash).c_str(), 0, INT_MAX, shard) &&
+         parse_number(spec.c_str() + slash + 1, 1, INT_MAX, shards) &&
+         shard < shards;
+}
 
-#pragma omp parallel for schedule(dynamic) private(                            \
-    candidate_indices, candidate_bitmaps) shared(known_bad_ij)
-  for (size_t i = 0; i < number_of_words; i++) {
-    const auto used_i = word_bitmaps[i];
+int main(int argc, char *argv[]) {
+  const auto start_time = std::chrono::steady_clock::now();
 
-    for (size_t j = i + 1; j < number_of_words; j++) {
-      if ((used_i & word_bitmaps[j]) != 0)
-        continue;
-      const auto used_ij = used_i | word_bitmaps[j];
+  // Stop once this many solutions have been found (0 for no limit)
+  size_t limit = 0;
+  // Stop once this many seconds have passed since startup (0 for no deadline)
+  double deadline = 0;
+  // Run the benchmark harness with this many timed iterations (0 to just solve)
+  int bench_iterations = 0;
+  int bench_warmup = 2;
+  // Report per-phase timings and hardware counters at the end
+  bool perf = false;
+  // Sweep the search over these thread counts instead of printing solutions
+  std::vector<int> scaling_threads;
+  // Solve every word list named in this file instead
+  const char *manifest = nullptr;
+  // Update the solutions in this file for the words added to and removed from
+  // the word list instead of solving from scratch
+  const char *previous = nullptr;
+  const char *added = nullptr;
+  const char *removed = nullptr;
+  // Only do piece shard (0 based) of the search split into shards pieces
+  int shard = 0, shards = 0;
+  // Merge the solutions in the output files named instead of solving
+  bool merge = false;
+  // Save progress to this file every so many seconds, and pick up from it
+  const char *checkpoint_file = nullptr;
+  double checkpoint_interval = 60;
+  bool resume = false;
+  // Look for sets of words of these lengths covering at least cover_goal
+  // letters instead
+  int min_length = 0, max_length = 0;
+  CoverGoal cover_goal;
+  // Look for the sets of at most this many words covering the most letters
+  // instead, keeping the top best (0 for every one as good as the best).
+  // Without --max-coverage, --top looks for the top highest scoring sets.
+  int max_coverage_words = 0;
+  size_t top = 0;
+  // Spell words with the symbols in this file rather than a to z
+  const char *alphabet_file = nullptr;
+  // Allow letters more than once, up to these counts
+  bool has_budget = false;
+  LetterBudget budget;
+  // Print the solutions as text, grouped by their first words, or as a JSON
+  // trie, or write them to output_file in the binary format of result_file.h
+  // with these flags. The others go to output_file too if given.
+  std::string format = "text";
+  const char *output_file = nullptr;
+  uint32_t result_flags = 0;
+  // Print the solutions in this binary result file instead of solving
+  const char *dump_file = nullptr;
+  std::vector<const char *> filenames;
+  const char *filename = nullptr;
 
-      if (known_bad_ij[used_ij]) {
-        continue;
+  for (int arg = 1; arg < argc; arg++) {
+    const std::string option = argv[arg];
+    if (option == "--limit" && arg + 1 < argc) {
+      if (!parse_number(argv[++arg], 0, LLONG_MAX, limit)) {
+        std::cerr << "--limit needs a number of solutions, 0 for no limit"
+                  << std::endl;
+        return 1;
+      }
+    } else if (option == "--deadline" && arg + 1 < argc) {
+      if (!parse_real(argv[++arg], std::numeric_limits<double>::max(),
+                      deadline)) {
+        std::cerr << "--deadline needs a number of seconds, 0 for none"
+                  << std::endl;
+        return 1;
+      }
+    } else if (option == "--bench" && arg + 1 < argc) {
+      if (!parse_number(argv[++arg], 0, INT_MAX, bench_iterations)) {
+        std::cerr << "--bench needs a number of iterations" << std::endl;
+        return 1;
       }
-      // Prune the remaining words down to a set of candidates that do not share
-      // a letter with either of the two words we've seen so far
-      candidate_bitmaps.clear();
-      candidate_indices.clear();
-
-      for (size_t index = 0; index < word_bitmaps_boundaries.size() - 1;
-           index++) {
-        // If this is 0, that means the given letter is not in used_ij, so
-        // search through the corresponding section looking for candidates
-        if ((letter_bitmaps[index] & used_ij) == 0) {
-          for (size_t k = std::max(j + 1, word_bitmaps_boundaries[index]);
-               k < word_bitmaps_boundaries[index + 1]; k++) {
-            if ((used_ij & word_bitmaps[k]) == 0) {
-              candidate_bitmaps.push_back(word_bitmaps[k]);
-              candidate_indices.push_back(k);
-            }
-          }
+    } else if (option == "--warmup" && arg + 1 < argc) {
+      if (!parse_number(argv[++arg], 0, INT_MAX, bench_warmup)) {
+        std::cerr << "--warmup needs a number of iterations" << std::endl;
+        return 1;
+      }
+    } else if (option == "--perf") {
+      perf = true;
+    } else if (option == "--scaling" && arg + 1 < argc) {
+      std::istringstream counts(argv[++arg]);
+      std::string count;
+      int threads = 0;
+      while (std::getline(counts, count, ',')) {
+        if (!parse_number(count.c_str(), 1, INT_MAX, threads)) {
+          std::cerr << "--scaling needs thread counts of at least 1, "
+                       "separated by commas"
+                    << std::endl;
+          return 1;
         }
+        scaling_threads.push_back(threads);
+      }
+    } else if (option == "--batch" && arg + 1 < argc) {
+      manifest = argv[++arg];
+    } else if (option == "--previous" && arg + 1 < argc) {
+      previous = argv[++arg];
+    } else if (option == "--added" && arg + 1 < argc) {
+      added = argv[++arg];
+    } else if (option == "--removed" && arg + 1 < argc) {
+      removed = argv[++arg];
+    } else if (option == "--shard" && arg + 1 < argc) {
+      if (!parse_shard(argv[++arg], shard, shards)) {
+        std::cerr << "--shard needs k/n, with k from 0 to n - 1" << std::endl;
+        return 1;
+      }
+    } else if (option == "--merge") {
+      merge = true;
+    } else if (option == "--checkpoint" && arg + 1 < argc) {
+      checkpoint_file = argv[++arg];
+    } else if (option == "--checkpoint-interval" && arg + 1 < argc) {
+      if (!parse_real(argv[++arg], std::numeric_limits<double>::max(),
+                      checkpoint_interval)) {
+        std::cerr << "--checkpoint-interval needs a number of seconds"
+                  << std::endl;
+        return 1;
+      }
+    } else if (option == "--resume") {
+      resume = true;
+    } else if (option == "--lengths" && arg + 1 < argc) {
+      if (!parse_range(argv[++arg], 1, ALPHABET_SIZE, min_length,
+                       max_length) ||
+          max_length < min_length) {
+        std::cerr << "--lengths needs MIN-MAX, from 1 to 26" << std::endl;
+        return 1;
+      }
+    } else if (option == "--target" && arg + 1 < argc) {
+      if (!parse_number(argv[++arg], 1, ALPHABET_SIZE, cover_goal.letters)) {
+        std::cerr << "--target needs a number of letters from 1 to 26"
+                  << std::endl;
+        return 1;
+      }
+    } else if (option == "--max-words" && arg + 1 < argc) {
+      if (!parse_number(argv[++arg], 0, ALPHABET_SIZE,
+                        cover_goal.max_words)) {
+        std::cerr << "--max-words needs a number of words from 0 (for no "
+                     "limit) to 26"
+                  << std::endl;
+        return 1;
+      }
+    } else if (option == "--max-coverage" && arg + 1 < argc) {
+      if (!parse_number(argv[++arg], 1, ALPHABET_SIZE, max_coverage_words)) {
+        std::cerr << "--max-coverage needs a number of words from 1 to 26"
+                  << std::endl;
+        return 1;
+      }
+    } else if (option == "--top" && arg + 1 < argc) {
+      if (!parse_number(argv[++arg], 0, LLONG_MAX, top)) {
+        std::cerr << "--top needs a number of sets" << std::endl;
+        return 1;
       }
+    } else if (option == "--alphabet" && arg + 1 < argc) {
+      alphabet_file = argv[++arg];
+    } else if (option == "--budget" && arg + 1 < argc) {
+      if (!parse_budget(argv[++arg], budget)) {
+        std::cerr << "--budget needs letters each followed by a count of at "
+                     "most "
+                  << MAX_LETTER_BUDGET << ", e.g. e2q1" << std::endl;
+        return 1;
+      }
+      has_budget = true;
+    } else if (option == "--format" && arg + 1 < argc) {
+      format = argv[++arg];
+      if (format != "text" && format != "tree" && format != "json" &&
+          format != "bin") {
+        std::cerr << "--format needs text, tree, json or bin" << std::endl;
+        return 1;
+      }
+    } else if (option == "--output" && arg + 1 < argc) {
+      output_file = argv[++arg];
+    } else if (option == "--sorted") {
+      result_flags |= RESULTS_SORTED;
+    } else if (option == "--delta") {
+      result_flags |= RESULTS_DELTA;
+    } else if (option == "--dump" && arg + 1 < argc) {
+      dump_file = argv[++arg];
+    } else {
+      filename = argv[arg];
+      filenames.push_back(filename);
+    }
+  }
 
-      const auto num_candidates = candidate_bitmaps.size();
-      if (num_candidates < WORD_LENGTH - 2)
-        continue;
+  if (resume && checkpoint_file == nullptr) {
+    std::cerr << "--resume needs --checkpoint FILE" << std::endl;
+    return 1;
+  }
 
-      bool found = false;
-      // From here, only search through the pruned set of candidates
-      for (size_t a = 0; a < num_candidates; a++) {
-        const auto a_bitmap = candidate_bitmaps[a];
-        const auto used_ijk = used_ij | a_bitmap;
-        for (size_t b = a + 1; b < num_candidates; b++) {
-          const auto b_bitmap = candidate_bitmaps[b];
-          if ((used_ijk & b_bitmap) != 0)
-            continue;
-          const auto used_ijkl = used_ijk | b_bitmap;
-          for (size_t c = b + 1; c < num_candidates; c++) {
-            const auto c_bitmap = candidate_bitmaps[c];
-            if ((used_ijkl & c_bitmap) != 0)
-              continue;
-            found = true;
-#pragma omp critical
-            {
-              matches.push_back({unique_words[i], unique_words[j],
-                                 unique_words[candidate_indices[a]],
-                                 unique_words[candidate_indices[b]],
-                                 unique_words[candidate_indices[c]]});
-            }
-          }
-        }
+  if (format == "bin" && output_file == nullptr) {
+    std::cerr << "--format bin needs --output FILE" << std::endl;
+    return 1;
+  }
+
+  // Every mode but the plain solve ignores the options that only it takes,
+  // and some searches can't stop at a limit or deadline, so rather than
+  // quietly drop an option say it doesn't apply. Modes are picked in this
+  // order, and --lengths, --max-coverage and --top go together.
+  std::vector<const char *> modes;
+  if (manifest != nullptr)
+    modes.push_back("--batch");
+  if (merge)
+    modes.push_back("--merge");
+  if (dump_file != nullptr)
+    modes.push_back("--dump");
+  if (has_budget)
+    modes.push_back("--budget");
+  if (alphabet_file != nullptr)
+    modes.push_back("--alphabet");
+  if (max_coverage_words > 0)
+    modes.push_back("--max-coverage");
+  else if (top > 0)
+    modes.push_back("--top");
+  else if (min_length > 0)
+    modes.push_back("--lengths");
+  if (previous != nullptr)
+    modes.push_back("--previous");
+  if (bench_iterations > 0)
+    modes.push_back("--bench");
+  if (!scaling_threads.empty())
+    modes.push_back("--scaling");
+  if (!modes.empty()) {
+    const std::string mode = modes[0];
+    const bool has_limit = mode == "--budget" || mode == "--alphabet" ||
+                           mode == "--lengths" || mode == "--previous";
+    const bool has_deadline =
+        has_limit || mode == "--max-coverage" || mode == "--top";
+    const char *option = nullptr;
+    if (modes.size() > 1)
+      option = modes[1];
+    else if (perf)
+      option = "--perf";
+    else if (shards > 0)
+      option = "--shard";
+    else if (checkpoint_file != nullptr)
+      option = "--checkpoint";
+    else if (format != "text")
+      option = "--format";
+    else if (output_file != nullptr)
+      option = "--output";
+    else if (limit > 0 && !has_limit)
+      option = "--limit";
+    else if (deadline > 0 && !has_deadline)
+      option = "--deadline";
+    if (option != nullptr) {
+      std::cerr << option << " doesn't go with " << mode << std::endl;
+      return 1;
+    }
+  }
+
+  if (manifest != nullptr)
+    return run_batch(manifest);
+  if (merge)
+    return run_merge(filenames);
+  if (dump_file != nullptr)
+    return run_dump(dump_file);
+
+  if (filename == nullptr) {
+    std::cerr << "Please provide wordlist filename!" << std::endl;
+    return 1;
+  }
+
+  // The limit and deadline hold for every mode that searches
+  Options options;
+  options.limit = limit;
+  options.has_deadline = deadline > 0;
+  options.deadline =
+      start_time +
+      std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+          std::chrono::duration<double>(deadline));
+
+  if (alphabet_file != nullptr || has_budget) {
+    if (has_budget)
+      return run_budget(filename, budget, options);
+    return run_alphabet(filename, alphabet_file, options);
+  }
+
+  if (min_length > 0 || max_coverage_words > 0 || top > 0) {
+    if (min_length == 0)
+      min_length = max_length = WORD_LENGTH;
+    if (max_coverage_words > 0)
+      return run_max_coverage(filename, min_length, max_length,
+                              max_coverage_words, top, options);
+    if (top > 0)
+      return run_top_covers(filename, min_length, max_length, cover_goal, top,
+                            options);
+    return run_covers(filename, min_length, max_length, cover_goal, options);
+  }
+
+  if (previous != nullptr)
+    return run_incremental(filename, previous, added, removed, options);
+
+  if (bench_iterations > 0)
+    return run_benchmark(filename, bench_iterations, bench_warmup);
+
+  // Tree and JSON are for other programs to read, so keep everything else a
+  // run says about itself out of the way on standard error
+  const bool structured = format == "tree" || format == "json";
+  std::ostream &report = structured ? std::cerr : std::cout;
+
+  PhaseProfiler profiler(perf);
+
+  // First, open the word list given on the command line and read in some
+  // words, filtering them down to the ones we actually care about as we go
+
+  profiler.begin();
+  Dictionary dictionary;
+  size_t number_of_lines = 0;
+  if (!read_dictionary(filename, dictionary, number_of_lines)) {
+    std::cerr << read_error() << std::endl;
+    return 2;
+  }
+  profiler.end("read and filter");
+
+  report << "Read " << number_of_lines << " words from " << filename
+         << std::endl;
+
+  report << "Found " << dictionary.size() << " unique words" << std::endl;
+
+  if (!scaling_threads.empty()) {
+    run_scaling(dictionary, scaling_threads);
+    return 0;
+  }
+
+  // Finally, it's time to actually look for some words!
+
+  Solver solver(dictionary);
+  // Tree and JSON output is grouped by pair, from each thread's solutions
+  CollectingVisitor visitor;
+#ifdef _OPENMP
+  PairCollectingVisitor pair_visitor(omp_get_max_threads());
+#else
+  PairCollectingVisitor pair_visitor(1);
+#endif
+
+  std::vector<uint32_t> first_words;
+  if (shards > 0) {
+    first_words = shard_first_words(dictionary, shard, shards);
+    options.first_words = &first_words;
+    report << "Shard " << shard << "/" << shards << ": "
+           << first_words.size() << " of " << dictionary.size()
+           << " first words" << std::endl;
+  }
+
+  std::unique_ptr<CheckpointingVisitor> checkpointer;
+  if (checkpoint_file != nullptr) {
+    Checkpoint resumed;
+    if (resume && read_checkpoint(checkpoint_file, resumed)) {
+      if (resumed.fingerprint != fingerprint(dictionary, shard, shards)) {
+        std::cerr << "Checkpoint " << checkpoint_file
+                  << " is for a different word list or shard" << std::endl;
+        return 2;
       }
-      if (!found) {
-        known_bad_ij[used_ij] = true;
+      solver.load_memo(resumed.memo);
+      options.reuse_memo = true;
+
+      // Carry on with whatever's left of the first words
+      if (options.first_words == nullptr) {
+        first_words.resize(dictionary.size());
+        std::iota(first_words.begin(), first_words.end(), 0);
+        options.first_words = &first_words;
       }
+      std::vector<bool> finished(dictionary.size(), false);
+      for (const uint32_t id : resumed.finished_first_words)
+        if (id < finished.size())
+          finished[id] = true;
+      first_words.erase(std::remove_if(first_words.begin(), first_words.end(),
+                                       [&finished](uint32_t id) {
+                                         return finished[id];
+                                       }),
+                        first_words.end());
+    } else if (resume) {
+      report << "No checkpoint to resume from in " << checkpoint_file
+             << ", starting afresh" << std::endl;
     }
+
+    checkpointer.reset(new CheckpointingVisitor(
+        dictionary, solver, fingerprint(dictionary, shard, shards),
+        checkpoint_file,
+        std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<double>(checkpoint_interval)),
+        resumed));
+    if (options.reuse_memo)
+      report << "Resuming from " << checkpoint_file << ": "
+             << first_words.size() << " first words to go, "
+             << checkpointer->solutions().size() << " solutions so far"
+             << std::endl;
   }
-  std::cout << "Damn, we had " << matches.size() << " successful finds!"
-            << std::endl
-            << "Here they all are:" << std::endl;
+  Visitor &search_visitor =
+      checkpointer ? static_cast<Visitor &>(*checkpointer)
+      : structured ? static_cast<Visitor &>(pair_visitor)
+                   : visitor;
 
-  for (const auto &match : matches) {
-    for (const auto &word : match) {
-      std::cout << word << " ";
+  PerfSample search_events;
+  if (profiler.counting_events())
+    options.events = &search_events;
+
+  profiler.begin();
+  const StopReason stop_reason = solver.solve(options, search_visitor);
+  profiler.end("search", options.events);
+
+  if (checkpointer) {
+    if (!checkpointer->finish()) {
+      std::cerr << "Could not write checkpoint " << checkpoint_file
+                << std::endl;
+      return 2;
     }
-    std::cout << std::endl;
+    report << "Wrote " << checkpointer->checkpoints_written()
+           << " checkpoints to " << checkpoint_file << std::endl;
+  }
+
+  report << "Memo table: " << solver.memo_table().describe() << std::endl;
+
+  switch (stop_reason) {
+  case NOT_STOPPED:
+    report << "Search complete" << std::endl;
+    break;
+  case LIMIT_REACHED:
+    report << "Search truncated: reached the limit of " << limit
+           << " solutions" << std::endl;
+    break;
+  case DEADLINE_PASSED:
+    report << "Search truncated: passed the deadline of " << deadline
+           << " seconds" << std::endl;
+    break;
+  case VISITOR_STOPPED:
+    break;
+  }
+
+  const std::vector<Solution> &matches =
+      checkpointer ? checkpointer->solutions() : visitor.matches;
+  const size_t number_of_matches =
+      checkpointer || !structured ? matches.size() : pair_visitor.size();
+  report << "Damn, we had " << number_of_matches << " successful finds!"
+         << std::endl;
+
+  profiler.begin();
+  if (format == "bin") {
+    if (!write_result_file(output_file, dictionary, matches, result_flags)) {
+      std::cerr << "Could not write result file: " << output_file
+                << std::endl;
+      return 2;
+    }
+    report << "Wrote them to " << output_file << std::endl;
+  } else if (structured) {
+    std::ofstream file;
+    if (output_file != nullptr)
+      file.open(output_file, std::ios::trunc);
+    std::ostream &out = output_file != nullptr ? file : std::cout;
+    PairGroups groups;
+    if (checkpointer)
+      groups.add(matches);
+    else
+      for (const auto &thread_matches : pair_visitor.matches)
+        groups.add(thread_matches);
+    if (format == "tree")
+      write_match_tree(out, dictionary, groups);
+    else
+      write_match_json(out, dictionary, groups);
+    if (output_file != nullptr) {
+      if (!file) {
+        std::cerr << "Could not write file: " << output_file << std::endl;
+        return 2;
+      }
+      report << "Wrote them to " << output_file << std::endl;
+    }
+  } else if (output_file != nullptr) {
+    if (!write_solutions_file(output_file, dictionary, matches)) {
+      std::cerr << "Could not write file: " << output_file << std::endl;
+      return 2;
+    }
+    report << "Wrote them to " << output_file << std::endl;
+  } else {
+    std::cout << "Here they all are:" << std::endl;
+    std::string text;
+    format_solutions(dictionary, matches, text);
+    std::cout.write(text.data(), text.size());
+    std::cout.flush();
   }
+  profiler.end("output");
 
   const auto end_time = std::chrono::steady_clock::now();
   const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
       end_time - start_time);
-  std::cout << "DONE in " << elapsed.count() / 1000.0 << " seconds"
-            << std::endl;
+  report << "DONE in " << elapsed.count() / 1000.0 << " seconds" << std::endl;
+
+  if (perf)
+    profiler.print(report);
 }
@@ -0,0 +1,130 @@
+/* This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/* C interface to the solver, exported by libfivewords.so. Nothing here throws
+ * or exposes C++ types; failures are reported through fw_status. */
+
+#ifndef FIVEWORDS_H
+#define FIVEWORDS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if defined(__GNUC__)
+#define FW_API __attribute__((visibility("default")))
+#else
+#define FW_API
+#endif
+
+/* Bumped whenever a function's signature or behaviour changes incompatibly */
+#define FW_ABI_VERSION 1
+
+#define FW_WORDS_PER_SOLUTION 5
+
+typedef enum {
+  FW_OK = 0,
+  /* A file couldn't be opened */
+  FW_ERROR_IO,
+  /* A null handle or otherwise bad argument */
+  FW_ERROR_INVALID_ARGUMENT,
+  FW_ERROR_OUT_OF_MEMORY,
+  FW_ERROR_INTERNAL
+} fw_status;
+
+typedef enum {
+  FW_COMPLETE = 0,
+  FW_LIMIT_REACHED,
+  FW_DEADLINE_PASSED,
+  /* The callback asked to stop, or the cursor was closed */
+  FW_STOPPED
+} fw_stop_reason;
+
+/* The filtered, deduplicated words of a word list. Immutable once opened, so
+ * a dictionary may be used by any number of threads and solves at once. */
+typedef struct fw_dictionary fw_dictionary;
+
+/* Settings for a solve */
+typedef struct fw_options fw_options;
+
+/* A solve in progress, whose solutions are fetched in batches */
+typedef struct fw_cursor fw_cursor;
+
+/* Called once per solution with the ids of its words. Runs on the solver's
+ * worker threads, several at a time. Return non-zero to stop the solve. */
+typedef int (*fw_solution_callback)(const uint32_t ids[FW_WORDS_PER_SOLUTION],
+                                    void *user_data);
+
+FW_API int fw_abi_version(void);
+
+/* Read a word list (one word per line) from a file, or from a buffer holding
+ * the same contents. The buffer isn't referenced after this returns. */
+FW_API fw_status fw_dictionary_open_path(const char *path,
+                                         fw_dictionary **dictionary);
+FW_API fw_status fw_dictionary_open_buffer(const char *data, size_t size,
+                                           fw_dictionary **dictionary);
+FW_API void fw_dictionary_close(fw_dictionary *dictionary);
+
+/* Number of usable words, whose ids are 0 to this minus one */
+FW_API size_t fw_dictionary_size(const fw_dictionary *dictionary);
+/* The word with the given id, valid until the dictionary is closed, or null if
+ * there's no such word */
+FW_API const char *fw_dictionary_word(const fw_dictionary *dictionary,
+                                      uint32_t id);
+
+FW_API fw_status fw_options_create(fw_options **options);
+FW_API void fw_options_destroy(fw_options *options);
+/* Number of worker threads, 0 (the default) for one per core */
+FW_API fw_status fw_options_set_threads(fw_options *options, int threads);
+/* Stop after this many solutions, 0 (the default) for no limit */
+FW_API fw_status fw_options_set_limit(fw_options *options, uint64_t limit);
+/* Stop this many milliseconds after the solve starts, 0 (the default) for no
+ * deadline */
+FW_API fw_status fw_options_set_deadline_ms(fw_options *options,
+                                            uint64_t milliseconds);
+/* Skip words containing any of the given lower case letters */
+FW_API fw_status fw_options_exclude_letters(fw_options *options,
+                                            const char *letters);
+
+/* Solve, calling callback for each solution. options may be null for the
+ * defaults, and reason may be null if the caller doesn't care. */
+FW_API fw_status fw_solve(const fw_dictionary *dictionary,
+                          const fw_options *options,
+                          fw_solution_callback callback, void *user_data,
+                          fw_stop_reason *reason);
+
+/* Start a solve whose solutions are pulled with fw_cursor_next. The search
+ * runs in the background, pausing whenever a batch's worth of solutions is
+ * waiting to be fetched. */
+FW_API fw_status fw_cursor_open(const fw_dictionary *dictionary,
+                                const fw_options *options,
+                                fw_cursor **cursor);
+/* Fill ids with up to capacity (at least 1) solutions, waiting for at least
+ * one, and store how many in count. A count of 0 means the solve is over. */
+FW_API fw_status fw_cursor_next(fw_cursor *cursor,
+                                uint32_t (*ids)[FW_WORDS_PER_SOLUTION],
+                                size_t capacity, size_t *count);
+/* Why the solve ended, once fw_cursor_next has returned a count of 0 */
+FW_API fw_stop_reason fw_cursor_stop_reason(const fw_cursor *cursor);
+/* Stop the solve if it's still going and release the cursor */
+FW_API void fw_cursor_close(fw_cursor *cursor);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
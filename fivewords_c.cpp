@@ -0,0 +1,244 @@
+// This program is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+// for more details.
+
+// You should have received a copy of the GNU General Public License along
+// with this program. If not, see <https://www.gnu.org/licenses/>.
+
+// The C interface in fivewords.h, wrapping five_words.h. Every entry point
+// catches whatever the C++ side throws and turns it into an fw_status. That
+// includes anything thrown on the search's own threads, which Solver::solve
+// and SolutionStream::next pass back to the calling thread.
+
+#include "fivewords.h"
+
+#include <chrono>
+#include <memory>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "five_words.h"
+
+struct fw_dictionary {
+  five_words::Dictionary dictionary;
+};
+
+struct fw_options {
+  int threads = 0;
+  uint64_t limit = 0;
+  uint64_t deadline_ms = 0;
+  uint32_t excluded_letters = 0;
+};
+
+struct fw_cursor {
+  std::unique_ptr<five_words::SolutionStream> stream;
+  std::vector<five_words::Solution> batch;
+};
+
+namespace {
+
+// The deadline only starts counting once the solve does
+five_words::Options to_options(const fw_options *options) {
+  five_words::Options converted;
+  if (options == nullptr)
+    return converted;
+  converted.threads = options->threads;
+  converted.limit = options->limit;
+  converted.excluded_letters = options->excluded_letters;
+  if (options->deadline_ms > 0) {
+    converted.has_deadline = true;
+    converted.deadline = std::chrono::steady_clock::now() +
+                         std::chrono::milliseconds(options->deadline_ms);
+  }
+  return converted;
+}
+
+fw_stop_reason to_stop_reason(five_words::StopReason reason) {
+  switch (reason) {
+  case five_words::NOT_STOPPED:
+    return FW_COMPLETE;
+  case five_words::LIMIT_REACHED:
+    return FW_LIMIT_REACHED;
+  case five_words::DEADLINE_PASSED:
+    return FW_DEADLINE_PASSED;
+  default:
+    return FW_STOPPED;
+  }
+}
+
+class CallbackVisitor : public five_words::Visitor {
+public:
+  CallbackVisitor(fw_solution_callback callback, void *user_data)
+      : callback_(callback), user_data_(user_data) {}
+
+  bool visit(const five_words::Solution &solution) override {
+    return callback_(solution.data(), user_data_) == 0;
+  }
+
+private:
+  fw_solution_callback callback_;
+  void *user_data_;
+};
+
+// Run body, mapping any exception it throws to a status
+template <typename Body> fw_status guarded(Body body) {
+  try {
+    return body();
+  } catch (const std::bad_alloc &) {
+    return FW_ERROR_OUT_OF_MEMORY;
+  } catch (...) {
+    return FW_ERROR_INTERNAL;
+  }
+}
+
+fw_status open_dictionary(const std::vector<std::string> &word_list,
+                          fw_dictionary **dictionary) {
+  *dictionary = new fw_dictionary{five_words::Dictionary(word_list)};
+  return FW_OK;
+}
+
+} // namespace
+
+int fw_abi_version(void) { return FW_ABI_VERSION; }
+
+fw_status fw_dictionary_open_path(const char *path,
+                                  fw_dictionary **dictionary) {
+  if (path == nullptr || dictionary == nullptr)
+    return FW_ERROR_INVALID_ARGUMENT;
+  return guarded([&]() {
+    std::vector<std::string> word_list;
+    if (!five_words::read_word_list(path, word_list))
+      return FW_ERROR_IO;
+    return open_dictionary(word_list, dictionary);
+  });
+}
+
+fw_status fw_dictionary_open_buffer(const char *data, size_t size,
+                                    fw_dictionary **dictionary) {
+  if ((data == nullptr && size > 0) || dictionary == nullptr)
+    return FW_ERROR_INVALID_ARGUMENT;
+  return guarded([&]() {
+    std::istringstream in(size > 0 ? std::string(data, size) : std::string());
+    std::vector<std::string> word_list;
+    five_words::read_word_list(in, word_list);
+    return open_dictionary(word_list, dictionary);
+  });
+}
+
+void fw_dictionary_close(fw_dictionary *dictionary) { delete dictionary; }
+
+size_t fw_dictionary_size(const fw_dictionary *dictionary) {
+  return dictionary == nullptr ? 0 : dictionary->dictionary.size();
+}
+
+const char *fw_dictionary_word(const fw_dictionary *dictionary, uint32_t id) {
+  if (dictionary == nullptr || id >= dictionary->dictionary.size())
+    return nullptr;
+  return dictionary->dictionary.word(id).c_str();
+}
+
+fw_status fw_options_create(fw_options **options) {
+  if (options == nullptr)
+    return FW_ERROR_INVALID_ARGUMENT;
+  return guarded([&]() {
+    *options = new fw_options();
+    return FW_OK;
+  });
+}
+
+void fw_options_destroy(fw_options *options) { delete options; }
+
+fw_status fw_options_set_threads(fw_options *options, int threads) {
+  if (options == nullptr || threads < 0)
+    return FW_ERROR_INVALID_ARGUMENT;
+  options->threads = threads;
+  return FW_OK;
+}
+
+fw_status fw_options_set_limit(fw_options *options, uint64_t limit) {
+  if (options == nullptr)
+    return FW_ERROR_INVALID_ARGUMENT;
+  options->limit = limit;
+  return FW_OK;
+}
+
+fw_status fw_options_set_deadline_ms(fw_options *options,
+                                     uint64_t milliseconds) {
+  if (options == nullptr)
+    return FW_ERROR_INVALID_ARGUMENT;
+  options->deadline_ms = milliseconds;
+  return FW_OK;
+}
+
+fw_status fw_options_exclude_letters(fw_options *options,
+                                     const char *letters) {
+  if (options == nullptr || letters == nullptr)
+    return FW_ERROR_INVALID_ARGUMENT;
+  uint32_t excluded = 0;
+  for (const char *c = letters; *c != '\0'; c++) {
+    if (*c < 'a' || *c > 'z')
+      return FW_ERROR_INVALID_ARGUMENT;
+    excluded |= 1 << (*c - 'a');
+  }
+  options->excluded_letters |= excluded;
+  return FW_OK;
+}
+
+fw_status fw_solve(const fw_dictionary *dictionary, const fw_options *options,
+                   fw_solution_callback callback, void *user_data,
+                   fw_stop_reason *reason) {
+  if (dictionary == nullptr || callback == nullptr)
+    return FW_ERROR_INVALID_ARGUMENT;
+  return guarded([&]() {
+    five_words::Solver solver(dictionary->dictionary);
+    CallbackVisitor visitor(callback, user_data);
+    const five_words::StopReason stop_reason =
+        solver.solve(to_options(options), visitor);
+    if (reason != nullptr)
+      *reason = to_stop_reason(stop_reason);
+    return FW_OK;
+  });
+}
+
+fw_status fw_cursor_open(const fw_dictionary *dictionary,
+                         const fw_options *options, fw_cursor **cursor) {
+  if (dictionary == nullptr || cursor == nullptr)
+    return FW_ERROR_INVALID_ARGUMENT;
+  return guarded([&]() {
+    std::unique_ptr<fw_cursor> opened(new fw_cursor());
+    opened->stream.reset(new five_words::SolutionStream(
+        dictionary->dictionary, to_options(options)));
+    *cursor = opened.release();
+    return FW_OK;
+  });
+}
+
+fw_status fw_cursor_next(fw_cursor *cursor,
+                         uint32_t (*ids)[FW_WORDS_PER_SOLUTION],
+                         size_t capacity, size_t *count) {
+  if (cursor == nullptr || count == nullptr || ids == nullptr || capacity == 0)
+    return FW_ERROR_INVALID_ARGUMENT;
+  return guarded([&]() {
+    cursor->batch.resize(capacity);
+    *count = cursor->stream->next(cursor->batch.data(), capacity);
+    for (size_t i = 0; i < *count; i++)
+      for (int word = 0; word < FW_WORDS_PER_SOLUTION; word++)
+        ids[i][word] = cursor->batch[i][word];
+    return FW_OK;
+  });
+}
+
+fw_stop_reason fw_cursor_stop_reason(const fw_cursor *cursor) {
+  return cursor == nullptr ? FW_STOPPED
+                           : to_stop_reason(cursor->stream->stop_reason());
+}
+
+void fw_cursor_close(fw_cursor *cursor) { delete cursor; }
@@ -0,0 +1,240 @@
+// This program is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+// for more details.
+
+// You should have received a copy of the GNU General Public License along
+// with this program. If not, see <https://www.gnu.org/licenses/>.
+
+// Generates synthetic word lists for scaling studies of fiveletterwords. All
+// randomness comes from a seeded std::mt19937_64, sampled without the standard
+// library distributions (whose output differs between implementations), so a
+// given seed produces the same list everywhere.
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+#include <algorithm>
+#include <limits>
+#include <numeric>
+#include <random>
+
+#include <iostream>
+
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "option_parsing.h"
+
+namespace {
+
+using five_words::parse_number;
+using five_words::parse_range;
+using five_words::parse_real;
+
+constexpr int ALPHABET_SIZE = 26;
+
+// Letters from most to least common in English text
+const char ENGLISH_ORDER[] = "etaoinshrdlcumwfgypbvkjxqz";
+
+// Relative frequency (percent) of each letter 'a' to 'z' in English text
+const double ENGLISH_FREQUENCIES[ALPHABET_SIZE] = {
+    8.2, 1.5,   2.8, 4.3, 12.7, 2.2, 2.0,  6.1, 7.0,  0.15, 0.77, 4.0, 2.4,
+    6.7, 7.5, 1.9, 0.095, 6.0, 6.3, 9.1, 2.8, 0.98, 2.4, 0.15, 2.0, 0.074};
+
+class Generator {
+public:
+  explicit Generator(uint64_t seed) : rng_(seed) {}
+
+  // Uniformly distributed in [0, 1)
+  double uniform() { return (rng_() >> 11) * (1.0 / 9007199254740992.0); }
+
+  // Uniformly distributed in [0, n)
+  size_t index(size_t n) { return static_cast<size_t>(uniform() * n); }
+
+  // Pick an index with probability proportional to weights[index]
+  size_t weighted(const std::vector<double> &weights) {
+    const double total = std::accumulate(weights.begin(), weights.end(), 0.0);
+    double target = uniform() * total;
+    for (size_t i = 0; i < weights.size(); i++) {
+      if (weights[i] <= 0)
+        continue;
+      if (target < weights[i])
+        return i;
+      target -= weights[i];
+    }
+    // Rounding, fall back on the last possible choice
+    for (size_t i = weights.size(); i-- > 0;)
+      if (weights[i] > 0)
+        return i;
+    return 0;
+  }
+
+  template <typename T> void shuffle(std::vector<T> &items) {
+    for (size_t i = items.size(); i > 1; i--)
+      std::swap(items[i - 1], items[index(i)]);
+  }
+
+private:
+  std::mt19937_64 rng_;
+};
+
+uint32_t bitmap_of(const std::string &word) {
+  uint32_t bitmap = 0;
+  for (const char c : word)
+    bitmap |= 1 << (c - 'a');
+  return bitmap;
+}
+
+void usage(std::ostream &out) {
+  out << "Usage: gendict [options]\n"
+         "  --words N              number of words to generate (10000)\n"
+         "  --length L[-M]         word length, or range of lengths (5)\n"
+         "  --distribution D       letter frequencies: uniform, english or\n"
+         "                         zipf (english)\n"
+         "  --zipf-exponent S      exponent for the zipf distribution, 0 or\n"
+         "                         more (1.0)\n"
+         "  --anagram-rate P       fraction of words that are anagrams of an\n"
+         "                         earlier word, from 0 to 1 (0.1)\n"
+         "  --repeat-rate P        fraction of words allowed to repeat a\n"
+         "                         letter, from 0 to 1 (0.3)\n"
+         "  --seed S               random seed, a whole number (1)\n"
+         "  --help                 print this and exit\n";
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+  uint64_t number_of_words = 10000;
+  uint64_t min_length = 5, max_length = 5;
+  std::string distribution = "english";
+  double zipf_exponent = 1.0;
+  double anagram_rate = 0.1;
+  double repeat_rate = 0.3;
+  uint64_t seed = 1;
+
+  for (int arg = 1; arg < argc; arg++) {
+    const std::string option = argv[arg];
+    if (option == "--help") {
+      usage(std::cout);
+      return 0;
+    }
+    if (arg + 1 >= argc) {
+      usage(std::cerr);
+      return 1;
+    }
+    const char *value = argv[++arg];
+    bool valid = true;
+    if (option == "--words") {
+      valid = parse_number(value, 0, UINT32_MAX, number_of_words);
+    } else if (option == "--length") {
+      valid = parse_range(value, 0, ALPHABET_SIZE, min_length, max_length);
+    } else if (option == "--distribution") {
+      distribution = value;
+    } else if (option == "--zipf-exponent") {
+      valid = parse_real(value, std::numeric_limits<double>::max(),
+                         zipf_exponent);
+    } else if (option == "--anagram-rate") {
+      valid = parse_real(value, 1, anagram_rate);
+    } else if (option == "--repeat-rate") {
+      valid = parse_real(value, 1, repeat_rate);
+    } else if (option == "--seed") {
+      valid = parse_number(value, 0, UINT64_MAX, seed);
+    } else {
+      valid = false;
+    }
+    if (!valid) {
+      usage(std::cerr);
+      return 1;
+    }
+  }
+
+  if (min_length < 1 || min_length > max_length ||
+      max_length > ALPHABET_SIZE) {
+    std::cerr << "Word lengths must be between 1 and " << ALPHABET_SIZE
+              << std::endl;
+    return 1;
+  }
+
+  std::vector<double> letter_weights(ALPHABET_SIZE);
+  if (distribution == "uniform") {
+    std::fill(letter_weights.begin(), letter_weights.end(), 1.0);
+  } else if (distribution == "english") {
+    letter_weights.assign(ENGLISH_FREQUENCIES,
+                          ENGLISH_FREQUENCIES + ALPHABET_SIZE);
+  } else if (distribution == "zipf") {
+    // Rank letters in their English order so the skew points the same way
+    for (int rank = 0; rank < ALPHABET_SIZE; rank++)
+      letter_weights[ENGLISH_ORDER[rank] - 'a'] =
+          1.0 / std::pow(rank + 1, zipf_exponent);
+  } else {
+    std::cerr << "Unknown distribution: " << distribution << std::endl;
+    return 1;
+  }
+
+  Generator generator(seed);
+  std::vector<std::string> words;
+  std::unordered_set<std::string> seen_words;
+  std::unordered_set<uint32_t> seen_bitmaps;
+  // Not all of a huge request, which can't be met anyway
+  words.reserve(std::min<uint64_t>(number_of_words, 1 << ALPHABET_SIZE));
+
+  // Give up on finding something new after this many tries in a row, which
+  // only happens once the requested size gets close to the number of possible
+  // letter sets
+  constexpr int MAX_FAILURES = 10000;
+  int failures = 0;
+
+  while (words.size() < number_of_words && failures < MAX_FAILURES) {
+    std::string word;
+    bool fresh;
+
+    if (!words.empty() && generator.uniform() < anagram_rate) {
+      // Rearrange an earlier word, same letter set under a different spelling
+      const std::string &original = words[generator.index(words.size())];
+      std::vector<char> letters(original.begin(), original.end());
+      generator.shuffle(letters);
+      word.assign(letters.begin(), letters.end());
+      fresh = seen_words.count(word) == 0;
+    } else {
+      const bool allow_repeats = generator.uniform() < repeat_rate;
+      const size_t length =
+          min_length + generator.index(max_length - min_length + 1);
+      std::vector<double> weights = letter_weights;
+      for (size_t i = 0; i < length; i++) {
+        const size_t letter = generator.weighted(weights);
+        word += static_cast<char>('a' + letter);
+        if (!allow_repeats)
+          weights[letter] = 0;
+      }
+      // New words should also be new letter sets, otherwise the anagram rate
+      // would mean nothing
+      fresh = seen_words.count(word) == 0 &&
+              seen_bitmaps.count(bitmap_of(word)) == 0;
+    }
+
+    if (!fresh) {
+      failures++;
+      continue;
+    }
+    failures = 0;
+    seen_words.insert(word);
+    seen_bitmaps.insert(bitmap_of(word));
+    words.push_back(word);
+  }
+
+  for (const auto &word : words)
+    std::cout << word << '\n';
+
+  std::cerr << "Generated " << words.size() << " words with "
+            << seen_bitmaps.size() << " distinct letter sets" << std::endl;
+  if (words.size() < number_of_words)
+    std::cerr << "Stopped early, ran out of new words to generate" << std::endl;
+}
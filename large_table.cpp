@@ -0,0 +1,167 @@
+// This program is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+// for more details.
+
+// You should have received a copy of the GNU General Public License along
+// with this program. If not, see <https://www.gnu.org/licenses/>.
+
+#include "large_table.h"
+
+#include <cstdlib>
+#include <cstring>
+
+#include <fstream>
+#include <new>
+#include <sstream>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#define FIVE_WORDS_HAVE_MMAP 1
+#ifndef MAP_HUGE_SHIFT
+#define MAP_HUGE_SHIFT 26
+#endif
+#ifndef MAP_HUGE_2MB
+#define MAP_HUGE_2MB (21 << MAP_HUGE_SHIFT)
+#endif
+#ifndef MAP_HUGE_1GB
+#define MAP_HUGE_1GB (30 << MAP_HUGE_SHIFT)
+#endif
+#endif
+
+namespace {
+
+constexpr size_t HUGE_2M = size_t(1) << 21;
+constexpr size_t HUGE_1G = size_t(1) << 30;
+
+size_t round_up(size_t n, size_t to) { return (n + to - 1) / to * to; }
+
+#ifdef FIVE_WORDS_HAVE_MMAP
+void *map_anonymous(size_t bytes, int extra_flags) {
+  void *p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE,
+                 MAP_PRIVATE | MAP_ANONYMOUS | extra_flags, -1, 0);
+  return p == MAP_FAILED ? nullptr : p;
+}
+#endif
+
+} // namespace
+
+LargeTable::LargeTable(size_t bytes) : size_(bytes) {
+  if (bytes == 0)
+    return;
+
+#ifdef FIVE_WORDS_HAVE_MMAP
+  // Explicit huge pages only succeed if the administrator has reserved some
+  // (vm.nr_hugepages), so these usually fall through on desktop machines.
+  // Don't bother with 1GB pages for tables that would mostly waste one.
+  if (bytes >= HUGE_1G) {
+    mapped_size_ = round_up(bytes, HUGE_1G);
+    if ((mapping_ = map_anonymous(mapped_size_, MAP_HUGETLB | MAP_HUGE_1GB))) {
+      data_ = mapping_;
+      backing_ = Backing::HugeTLB1G;
+      return;
+    }
+  }
+  if (bytes >= HUGE_2M) {
+    mapped_size_ = round_up(bytes, HUGE_2M);
+    if ((mapping_ = map_anonymous(mapped_size_, MAP_HUGETLB | MAP_HUGE_2MB))) {
+      data_ = mapping_;
+      backing_ = Backing::HugeTLB2M;
+      return;
+    }
+  }
+
+  // Otherwise map a normal region, over-allocating so the table itself can
+  // start on a 2MB boundary, which transparent huge pages require.
+  mapped_size_ = round_up(bytes, HUGE_2M) + HUGE_2M;
+  if ((mapping_ = map_anonymous(mapped_size_, 0))) {
+    const uintptr_t base = reinterpret_cast<uintptr_t>(mapping_);
+    data_ = reinterpret_cast<void *>(round_up(base, HUGE_2M));
+    backing_ = madvise(data_, round_up(bytes, HUGE_2M), MADV_HUGEPAGE) == 0
+                   ? Backing::TransparentHuge
+                   : Backing::Normal;
+    return;
+  }
+  mapping_ = nullptr;
+  mapped_size_ = 0;
+#endif
+
+  // Large callocs are served from fresh (already zero) pages as well
+  data_ = std::calloc(1, bytes);
+  if (data_ == nullptr)
+    throw std::bad_alloc();
+  backing_ = Backing::Heap;
+}
+
+LargeTable::~LargeTable() {
+#ifdef FIVE_WORDS_HAVE_MMAP
+  if (mapping_ != nullptr) {
+    munmap(mapping_, mapped_size_);
+    return;
+  }
+#endif
+  std::free(data_);
+}
+
+void LargeTable::reset() {
+#ifdef FIVE_WORDS_HAVE_MMAP
+  if (mapping_ != nullptr &&
+      madvise(data_, round_up(size_, backing_ == Backing::HugeTLB1G ? HUGE_1G
+                                                                    : HUGE_2M),
+              MADV_DONTNEED) == 0)
+    return;
+#endif
+  std::memset(data_, 0, size_);
+}
+
+long LargeTable::huge_page_bytes() const {
+  switch (backing_) {
+  case Backing::HugeTLB1G:
+  case Backing::HugeTLB2M:
+    return static_cast<long>(size_);
+  case Backing::Heap:
+    return -1;
+  default:
+    break;
+  }
+
+  // Sum AnonHugePages over every mapping overlapping the table
+  std::ifstream smaps("/proc/self/smaps");
+  if (!smaps.is_open())
+    return -1;
+  const uintptr_t begin = reinterpret_cast<uintptr_t>(data_);
+  const uintptr_t end = begin + size_;
+  long total_kb = 0;
+  bool overlapping = false;
+  std::string line;
+  while (std::getline(smaps, line)) {
+    unsigned long lo, hi;
+    char dash;
+    std::istringstream header(line);
+    // Mapping headers are the only lines whose first field has no ':'
+    if (line.find(':') > line.find(' ') &&
+        header >> std::hex >> lo >> dash >> hi && dash == '-') {
+      overlapping = lo < end && hi > begin;
+    } else if (overlapping && line.compare(0, 14, "AnonHugePages:") == 0) {
+      total_kb += std::strtol(line.c_str() + 14, nullptr, 10);
+    }
+  }
+  return total_kb * 1024;
+}
+
+std::string LargeTable::describe() const {
+  static const char *const names[] = {
+      "1GB hugetlbfs pages", "2MB hugetlbfs pages",
+      "transparent huge pages (madvise)", "4KB pages", "heap"};
+  std::ostringstream out;
+  out << (size_ >> 20) << " MiB on " << names[static_cast<int>(backing_)];
+  const long huge = huge_page_bytes();
+  if (huge >= 0)
+    out << ", " << (huge >> 20) << " MiB resident in huge pages";
+  return out.str();
+}
@@ -0,0 +1,158 @@
+// This program is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+// for more details.
+
+// You should have received a copy of the GNU General Public License along
+// with this program. If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef FIVE_WORDS_LARGE_TABLE_H
+#define FIVE_WORDS_LARGE_TABLE_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include <string>
+
+// A zero-initialized block of memory for the big lookup tables. Random probes
+// into a multi-megabyte table are dominated by TLB misses when it is backed by
+// 4KB pages, so try to get huge pages instead: first an explicit hugetlbfs
+// mapping (1GB pages for tables that can use them, then 2MB), then an ordinary
+// anonymous mapping with MADV_HUGEPAGE so transparent huge pages can back it.
+// Anonymous mappings are zero-filled lazily by the kernel, so there is no
+// up-front memset.
+class LargeTable {
+public:
+  enum class Backing { HugeTLB1G, HugeTLB2M, TransparentHuge, Normal, Heap };
+
+  explicit LargeTable(size_t bytes);
+  ~LargeTable();
+
+  LargeTable(const LargeTable &) = delete;
+  LargeTable &operator=(const LargeTable &) = delete;
+
+  void *data() const { return data_; }
+  size_t size() const { return size_; }
+  Backing backing() const { return backing_; }
+
+  // Zero the table again. For mappings, the pages are handed back to the
+  // kernel and are zero-filled on the next touch.
+  void reset();
+
+  // How many bytes of the table are currently backed by huge pages, or -1 if
+  // the kernel doesn't tell us
+  long huge_page_bytes() const;
+
+  // A one line summary of the size and placement of the table
+  std::string describe() const;
+
+private:
+  void *data_ = nullptr;
+  size_t size_ = 0;
+  size_t mapped_size_ = 0;
+  void *mapping_ = nullptr;
+  Backing backing_ = Backing::Heap;
+};
+
+// A bitset over a LargeTable. Bits may be set and tested concurrently from
+// several threads; a test racing with a set of the same bit may see either
+// value.
+class AtomicBitset {
+public:
+  explicit AtomicBitset(size_t bits)
+      : table_(((bits + 63) / 64) * sizeof(uint64_t)),
+        words_(static_cast<uint64_t *>(table_.data())) {}
+
+  bool test(size_t bit) const {
+    return (__atomic_load_n(&words_[bit / 64], __ATOMIC_RELAXED) >>
+            (bit % 64)) &
+           1;
+  }
+
+  void set(size_t bit) {
+    __atomic_fetch_or(&words_[bit / 64], uint64_t(1) << (bit % 64),
+                      __ATOMIC_RELAXED);
+  }
+
+  void reset() { table_.reset(); }
+
+  const LargeTable &table() const { return table_; }
+
+private:
+  LargeTable table_;
+  uint64_t *words_;
+};
+
+// Like AtomicBitset, but clear() is O(1): each 64-bit cell holds 32 bits of
+// the set along with the epoch they were written in, and bits from any epoch
+// but the current one read as 0. That's twice the memory of a plain bitset,
+// in exchange for never having to zero (or refault) the table between uses.
+// clear() must not race with test() or set().
+class EpochBitset {
+public:
+  explicit EpochBitset(size_t bits)
+      : table_(((bits + 31) / 32) * sizeof(uint64_t)),
+        cells_(static_cast<uint64_t *>(table_.data())) {}
+
+  bool test(size_t bit) const {
+    const uint64_t cell = __atomic_load_n(&cells_[bit / 32], __ATOMIC_RELAXED);
+    return (cell >> 32) == epoch_ && ((cell >> (bit % 32)) & 1);
+  }
+
+  void set(size_t bit) {
+    uint64_t *cell = &cells_[bit / 32];
+    const uint64_t mask = uint64_t(1) << (bit % 32);
+    uint64_t old_cell = __atomic_load_n(cell, __ATOMIC_RELAXED);
+    for (;;) {
+      // A cell left over from an earlier epoch starts again from empty
+      const uint64_t new_cell = (old_cell >> 32) == epoch_
+                                    ? old_cell | mask
+                                    : (uint64_t(epoch_) << 32) | mask;
+      if (new_cell == old_cell ||
+          __atomic_compare_exchange_n(cell, &old_cell, new_cell, true,
+                                      __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        return;
+    }
+  }
+
+  void clear() {
+    // Epoch 0 is what a freshly zeroed cell says, so it's never current. Once
+    // every other epoch has been used, wipe the table for real.
+    if (++epoch_ == 0) {
+      table_.reset();
+      epoch_ = 1;
+    }
+  }
+
+  // Copy the set out as a plain bitset, 64 bits to a word, or replace it with
+  // one. Copying out may race with set(), picking up some of the new bits.
+  void copy_to(uint64_t *bits) const {
+    for (size_t n = 0; n < table_.size() / sizeof(uint64_t); n++) {
+      const uint64_t cell = __atomic_load_n(&cells_[n], __ATOMIC_RELAXED);
+      if (n % 2 == 0)
+        bits[n / 2] = 0;
+      if ((cell >> 32) == epoch_)
+        bits[n / 2] |= (cell & 0xffffffff) << (32 * (n % 2));
+    }
+  }
+  void copy_from(const uint64_t *bits) {
+    for (size_t n = 0; n < table_.size() / sizeof(uint64_t); n++) {
+      const uint64_t half = (bits[n / 2] >> (32 * (n % 2))) & 0xffffffff;
+      cells_[n] = half != 0 ? (uint64_t(epoch_) << 32) | half : 0;
+    }
+  }
+
+  const LargeTable &table() const { return table_; }
+
+private:
+  LargeTable table_;
+  uint64_t *cells_;
+  uint32_t epoch_ = 1;
+};
+
+#endif
@@ -0,0 +1,75 @@
+// This program is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+// for more details.
+
+// You should have received a copy of the GNU General Public License along
+// with this program. If not, see <https://www.gnu.org/licenses/>.
+
+// Strict parsing of command line option values, shared by the programs. Each
+// takes the whole of the text or nothing: no signs, spaces or trailing junk.
+// (std::stoul and friends throw on junk instead, and std::stoul takes "-1" as
+// a huge number.)
+
+#ifndef FIVE_WORDS_OPTION_PARSING_H
+#define FIVE_WORDS_OPTION_PARSING_H
+
+#include <cctype>
+#include <cerrno>
+#include <cstdlib>
+#include <string>
+
+namespace five_words {
+
+// Parse text as a whole number from min to max into value
+template <typename Number>
+inline bool parse_number(const char *text, unsigned long long min,
+                         unsigned long long max, Number &value) {
+  if (!std::isdigit(static_cast<unsigned char>(*text)))
+    return false;
+  char *end = nullptr;
+  errno = 0;
+  const unsigned long long parsed = std::strtoull(text, &end, 10);
+  if (*end != '\0' || errno == ERANGE || parsed < min || parsed > max)
+    return false;
+  value = static_cast<Number>(parsed);
+  return true;
+}
+
+// Parse text as a whole number from min to max, or two of them separated by a
+// dash, into low and high, which are the same for one number
+template <typename Number>
+inline bool parse_range(const char *text, unsigned long long min,
+                        unsigned long long max, Number &low, Number &high) {
+  const std::string range = text;
+  const size_t dash = range.find('-');
+  if (!parse_number(range.substr(0, dash).c_str(), min, max, low))
+    return false;
+  high = low;
+  return dash == std::string::npos ||
+         parse_number(range.c_str() + dash + 1, min, max, high);
+}
+
+// Parse text as a number from 0 to max into value. It has to start with a
+// digit or a point, as -Ofast assumes there are no NaNs or infinities to
+// check for afterwards.
+inline bool parse_real(const char *text, double max, double &value) {
+  if (!std::isdigit(static_cast<unsigned char>(*text)) && *text != '.')
+    return false;
+  char *end = nullptr;
+  errno = 0;
+  const double parsed = std::strtod(text, &end);
+  if (*end != '\0' || errno == ERANGE || parsed > max)
+    return false;
+  value = parsed;
+  return true;
+}
+
+} // namespace five_words
+
+#endif
@@ -0,0 +1,168 @@
+// This program is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+// for more details.
+
+// You should have received a copy of the GNU General Public License along
+// with this program. If not, see <https://www.gnu.org/licenses/>.
+
+#include "perf_counters.h"
+
+#include <cerrno>
+#include <cstring>
+
+#include <sstream>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#define FIVE_WORDS_HAVE_PERF_EVENTS 1
+#endif
+
+namespace {
+
+const char *const EVENT_NAMES[NUMBER_OF_PERF_EVENTS] = {
+    "cycles",     "instructions", "branch-misses",
+    "L1D-misses", "LLC-misses",   "dTLB-misses"};
+
+#ifdef FIVE_WORDS_HAVE_PERF_EVENTS
+constexpr uint64_t cache_miss(uint64_t cache) {
+  return cache | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+         (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+}
+
+const struct {
+  uint32_t type;
+  uint64_t config;
+} EVENT_CONFIGS[NUMBER_OF_PERF_EVENTS] = {
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+    {PERF_TYPE_HW_CACHE, cache_miss(PERF_COUNT_HW_CACHE_L1D)},
+    {PERF_TYPE_HW_CACHE, cache_miss(PERF_COUNT_HW_CACHE_LL)},
+    {PERF_TYPE_HW_CACHE, cache_miss(PERF_COUNT_HW_CACHE_DTLB)},
+};
+#endif
+
+} // namespace
+
+PerfSample &PerfSample::operator+=(const PerfSample &other) {
+  for (int event = 0; event < NUMBER_OF_PERF_EVENTS; event++) {
+    counts[event] += other.counts[event];
+    valid[event] = valid[event] || other.valid[event];
+  }
+  return *this;
+}
+
+double PerfSample::ipc() const {
+  if (!valid[CYCLES] || !valid[INSTRUCTIONS] || counts[CYCLES] == 0)
+    return -1;
+  return static_cast<double>(counts[INSTRUCTIONS]) / counts[CYCLES];
+}
+
+double PerfSample::mpki(PerfEvent event) const {
+  if (!valid[event] || !valid[INSTRUCTIONS] || counts[INSTRUCTIONS] == 0)
+    return -1;
+  return 1000.0 * counts[event] / counts[INSTRUCTIONS];
+}
+
+std::string PerfSample::describe() const {
+  std::ostringstream out;
+  out.precision(3);
+  const double instructions_per_cycle = ipc();
+  out << "IPC ";
+  if (instructions_per_cycle >= 0)
+    out << instructions_per_cycle;
+  else
+    out << "n/a";
+  for (int event = BRANCH_MISSES; event < NUMBER_OF_PERF_EVENTS; event++) {
+    const double misses = mpki(static_cast<PerfEvent>(event));
+    out << ", " << EVENT_NAMES[event] << " ";
+    if (misses >= 0)
+      out << misses << " MPKI";
+    else
+      out << "n/a";
+  }
+  return out.str();
+}
+
+PerfCounters::PerfCounters() {
+  for (int event = 0; event < NUMBER_OF_PERF_EVENTS; event++)
+    fds_[event] = -1;
+
+#ifdef FIVE_WORDS_HAVE_PERF_EVENTS
+  // Counters aren't grouped, since six events may not fit on the PMU at once;
+  // the kernel multiplexes them instead and stop() scales the counts up by
+  // the fraction of the time each one was actually running.
+  for (int event = 0; event < NUMBER_OF_PERF_EVENTS; event++) {
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = EVENT_CONFIGS[event].type;
+    attr.config = EVENT_CONFIGS[event].config;
+    attr.disabled = 1;
+    // User space only, which is all perf_event_paranoid=2 allows anyway
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format =
+        PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    fds_[event] = static_cast<int>(
+        syscall(SYS_perf_event_open, &attr, 0 /* this thread */,
+                -1 /* any cpu */, -1 /* no group */, 0));
+    if (fds_[event] >= 0) {
+      available_ = true;
+    } else if (error_.empty()) {
+      error_ = std::string("perf_event_open(") + EVENT_NAMES[event] +
+               "): " + std::strerror(errno);
+    }
+  }
+#else
+  error_ = "perf events are only supported on Linux";
+#endif
+}
+
+PerfCounters::~PerfCounters() {
+#ifdef FIVE_WORDS_HAVE_PERF_EVENTS
+  for (int event = 0; event < NUMBER_OF_PERF_EVENTS; event++)
+    if (fds_[event] >= 0)
+      close(fds_[event]);
+#endif
+}
+
+void PerfCounters::start() {
+#ifdef FIVE_WORDS_HAVE_PERF_EVENTS
+  for (int event = 0; event < NUMBER_OF_PERF_EVENTS; event++) {
+    if (fds_[event] >= 0) {
+      ioctl(fds_[event], PERF_EVENT_IOC_RESET, 0);
+      ioctl(fds_[event], PERF_EVENT_IOC_ENABLE, 0);
+    }
+  }
+#endif
+}
+
+PerfSample PerfCounters::stop() {
+  PerfSample sample;
+#ifdef FIVE_WORDS_HAVE_PERF_EVENTS
+  for (int event = 0; event < NUMBER_OF_PERF_EVENTS; event++) {
+    if (fds_[event] < 0)
+      continue;
+    ioctl(fds_[event], PERF_EVENT_IOC_DISABLE, 0);
+    // value, time enabled, time running
+    uint64_t values[3];
+    if (read(fds_[event], values, sizeof(values)) != sizeof(values) ||
+        values[2] == 0)
+      continue;
+    sample.counts[event] = static_cast<uint64_t>(
+        static_cast<double>(values[0]) * values[1] / values[2]);
+    sample.valid[event] = true;
+  }
+#endif
+  return sample;
+}
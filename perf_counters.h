@@ -0,0 +1,77 @@
+// This program is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+// for more details.
+
+// You should have received a copy of the GNU General Public License along
+// with this program. If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef FIVE_WORDS_PERF_COUNTERS_H
+#define FIVE_WORDS_PERF_COUNTERS_H
+
+#include <cstdint>
+
+#include <string>
+
+// Hardware events counted by PerfCounters
+enum PerfEvent {
+  CYCLES = 0,
+  INSTRUCTIONS,
+  BRANCH_MISSES,
+  L1D_MISSES,
+  LLC_MISSES,
+  DTLB_MISSES,
+  NUMBER_OF_PERF_EVENTS
+};
+
+// Event counts over some stretch of execution, possibly summed over several
+// threads. An event that couldn't be counted is marked as not valid.
+struct PerfSample {
+  uint64_t counts[NUMBER_OF_PERF_EVENTS] = {};
+  bool valid[NUMBER_OF_PERF_EVENTS] = {};
+
+  PerfSample &operator+=(const PerfSample &other);
+
+  // Instructions per cycle, and misses per thousand instructions, or a
+  // negative number if the inputs weren't counted
+  double ipc() const;
+  double mpki(PerfEvent event) const;
+
+  // e.g. "IPC 1.52, branch-misses 3.1 MPKI, L1D-misses 20.4 MPKI, ..."
+  std::string describe() const;
+};
+
+// Counters for the calling thread, opened through perf_event_open. Each thread
+// that wants to be measured needs its own PerfCounters. If the kernel won't
+// give us counters (perf_event_paranoid, containers, virtual machines without
+// a PMU, non-Linux systems) everything still works but samples come back
+// with no valid events.
+class PerfCounters {
+public:
+  PerfCounters();
+  ~PerfCounters();
+
+  PerfCounters(const PerfCounters &) = delete;
+  PerfCounters &operator=(const PerfCounters &) = delete;
+
+  // Whether any of the events could be opened, and if not, why not
+  bool available() const { return available_; }
+  const std::string &error() const { return error_; }
+
+  // Zero and start the counters
+  void start();
+  // Stop the counters and read them
+  PerfSample stop();
+
+private:
+  int fds_[NUMBER_OF_PERF_EVENTS];
+  bool available_ = false;
+  std::string error_;
+};
+
+#endif
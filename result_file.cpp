@@ -0,0 +1,161 @@
+// This program is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+// for more details.
+
+// You should have received a copy of the GNU General Public License along
+// with this program. If not, see <https://www.gnu.org/licenses/>.
+
+#include "result_file.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+namespace five_words {
+
+namespace {
+
+const char MAGIC[8] = {'F', 'W', 'R', 'S', 'L', 'T', 0, 1};
+
+template <typename Id>
+void write_ids(std::ostream &out, const std::vector<Solution> &solutions,
+               bool delta) {
+  std::vector<Id> ids(WORDS_PER_SOLUTION * solutions.size());
+  for (size_t n = 0; n < solutions.size(); n++)
+    for (int word = 0; word < WORDS_PER_SOLUTION; word++)
+      ids[WORDS_PER_SOLUTION * n + word] = static_cast<Id>(
+          delta && word > 0 ? solutions[n][word] - solutions[n][word - 1]
+                            : solutions[n][word]);
+  out.write(reinterpret_cast<const char *>(ids.data()),
+            ids.size() * sizeof(Id));
+}
+
+template <typename Id> Solution read_ids(const Id *ids, bool delta) {
+  Solution solution;
+  for (int word = 0; word < WORDS_PER_SOLUTION; word++)
+    solution[word] =
+        ids[word] + (delta && word > 0 ? solution[word - 1] : uint32_t(0));
+  return solution;
+}
+
+} // namespace
+
+bool write_result_file(const std::string &filename,
+                       const Dictionary &dictionary,
+                       const std::vector<Solution> &solutions,
+                       uint32_t flags) {
+  if (flags & RESULTS_DELTA)
+    flags |= RESULTS_SORTED;
+
+  std::vector<uint32_t> offsets;
+  std::string characters;
+  for (uint32_t id = 0; id < dictionary.size(); id++) {
+    offsets.push_back(characters.size());
+    characters += dictionary.word(id);
+    characters += '\0';
+  }
+  offsets.push_back(characters.size());
+
+  ResultHeader header;
+  std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+  header.flags = flags;
+  header.id_bytes = dictionary.size() <= 0x10000 ? 2 : 4;
+  header.words = dictionary.size();
+  header.solutions = solutions.size();
+  header.characters_offset =
+      sizeof(header) + offsets.size() * sizeof(uint32_t);
+  header.solutions_offset =
+      (header.characters_offset + characters.size() + 7) / 8 * 8;
+
+  std::vector<Solution> sorted;
+  if (flags & RESULTS_SORTED) {
+    sorted = solutions;
+    for (auto &solution : sorted)
+      std::sort(solution.begin(), solution.end());
+    std::sort(sorted.begin(), sorted.end());
+  }
+  const std::vector<Solution> &written =
+      flags & RESULTS_SORTED ? sorted : solutions;
+
+  std::ofstream out(filename, std::ios::binary | std::ios::trunc);
+  out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  out.write(reinterpret_cast<const char *>(offsets.data()),
+            offsets.size() * sizeof(uint32_t));
+  out.write(characters.data(), characters.size());
+  const char padding[8] = {};
+  out.write(padding, header.solutions_offset - header.characters_offset -
+                         characters.size());
+  if (header.id_bytes == 2)
+    write_ids<uint16_t>(out, written, flags & RESULTS_DELTA);
+  else
+    write_ids<uint32_t>(out, written, flags & RESULTS_DELTA);
+  out.flush();
+  return static_cast<bool>(out);
+}
+
+bool ResultFile::open(const std::string &filename) {
+  if (!file_.open(filename) || file_.size() < sizeof(ResultHeader))
+    return false;
+  const ResultHeader *header =
+      reinterpret_cast<const ResultHeader *>(file_.data());
+  // Don't believe a corrupt header enough to read past the end
+  const uint64_t size = file_.size();
+  if (std::memcmp(header->magic, MAGIC, sizeof(MAGIC)) != 0 ||
+      (header->id_bytes != 2 && header->id_bytes != 4) ||
+      header->words >= size / sizeof(uint32_t) ||
+      header->characters_offset !=
+          sizeof(ResultHeader) + (header->words + 1) * sizeof(uint32_t) ||
+      header->solutions_offset < header->characters_offset ||
+      header->solutions_offset > size ||
+      header->solutions_offset % sizeof(uint32_t) != 0 ||
+      header->solutions > (size - header->solutions_offset) /
+                              (WORDS_PER_SOLUTION * header->id_bytes))
+    return false;
+
+  // Every word has to start where the one before ended and end with a '\0'
+  // inside the characters, so word() never runs off the end
+  const uint32_t *offsets = reinterpret_cast<const uint32_t *>(
+      file_.data() + sizeof(ResultHeader));
+  const char *characters = file_.data() + header->characters_offset;
+  const uint64_t characters_size =
+      header->solutions_offset - header->characters_offset;
+  if (offsets[0] != 0 || offsets[header->words] > characters_size)
+    return false;
+  for (uint64_t id = 0; id < header->words; id++)
+    if (offsets[id + 1] <= offsets[id] ||
+        characters[offsets[id + 1] - 1] != '\0')
+      return false;
+
+  header_ = header;
+  offsets_ = offsets;
+  characters_ = characters;
+  ids_ = file_.data() + header->solutions_offset;
+
+  // And every solution has to be of words that are there
+  for (size_t n = 0; n < header->solutions; n++)
+    for (const uint32_t id : solution(n))
+      if (id >= header->words) {
+        header_ = nullptr;
+        return false;
+      }
+  return true;
+}
+
+Solution ResultFile::solution(size_t n) const {
+  const bool delta = header_->flags & RESULTS_DELTA;
+  if (header_->id_bytes == 2)
+    return read_ids(static_cast<const uint16_t *>(ids_) +
+                        WORDS_PER_SOLUTION * n,
+                    delta);
+  return read_ids(static_cast<const uint32_t *>(ids_) +
+                      WORDS_PER_SOLUTION * n,
+                  delta);
+}
+
+} // namespace five_words
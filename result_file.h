@@ -0,0 +1,91 @@
+// This program is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+// for more details.
+
+// You should have received a copy of the GNU General Public License along
+// with this program. If not, see <https://www.gnu.org/licenses/>.
+
+// A compact binary file of solutions, to keep or hand on without formatting
+// and parsing text: a header, the words of the dictionary once, and then each
+// solution as five word ids, two bytes each if there are few enough words and
+// four otherwise. It's laid out to be mapped and used in place.
+//
+// Layout, in the machine's own byte order like checkpoints:
+//   ResultHeader
+//   uint32_t offsets[words + 1]   where each word starts in the characters
+//   char characters[]             the words, each followed by a '\0'
+//   padding to a multiple of 8 bytes
+//   uint16_t or uint32_t ids[solutions][5]
+
+#ifndef FIVE_WORDS_RESULT_FILE_H
+#define FIVE_WORDS_RESULT_FILE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "five_words.h"
+#include "word_input.h"
+
+namespace five_words {
+
+struct ResultHeader {
+  char magic[8];
+  // RESULTS_SORTED and RESULTS_DELTA
+  uint32_t flags;
+  // 2 or 4
+  uint32_t id_bytes;
+  uint64_t words;
+  uint64_t solutions;
+  // From the start of the file
+  uint64_t characters_offset;
+  uint64_t solutions_offset;
+};
+
+// The ids of each solution are in increasing order, and the solutions are
+// sorted
+constexpr uint32_t RESULTS_SORTED = 1;
+// Each id but the first of a solution is stored as the difference from the
+// one before, which leaves small numbers for a general purpose compressor to
+// squeeze further. Implies RESULTS_SORTED.
+constexpr uint32_t RESULTS_DELTA = 2;
+
+// Write solutions of dictionary to filename with the given flags. Returns
+// false if the file couldn't be written.
+bool write_result_file(const std::string &filename,
+                       const Dictionary &dictionary,
+                       const std::vector<Solution> &solutions,
+                       uint32_t flags = 0);
+
+// A result file mapped into memory
+class ResultFile {
+public:
+  // Returns false if filename can't be read or isn't a well formed result
+  // file: offsets out of order or past the characters, a word without its
+  // '\0', or a solution with an id that isn't one of the words
+  bool open(const std::string &filename);
+
+  uint32_t flags() const { return header_->flags; }
+  size_t words() const { return header_->words; }
+  size_t size() const { return header_->solutions; }
+
+  const char *word(uint32_t id) const { return characters_ + offsets_[id]; }
+  Solution solution(size_t n) const;
+
+private:
+  MappedFile file_;
+  const ResultHeader *header_ = nullptr;
+  const uint32_t *offsets_ = nullptr;
+  const char *characters_ = nullptr;
+  const void *ids_ = nullptr;
+};
+
+} // namespace five_words
+
+#endif
@@ -0,0 +1,278 @@
+// This program is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+// for more details.
+
+// You should have received a copy of the GNU General Public License along
+// with this program. If not, see <https://www.gnu.org/licenses/>.
+
+// Internal to the library, shared by the searches
+
+// The search for five words, written once for every sort of word the library
+// searches: a to z as the bits of a uint32_t for Solver, up to 128 symbols as
+// the bits of a uint32_t, uint64_t or unsigned __int128 for an Alphabet, and
+// letter counts for a LetterBudget. For every first word i, and every second
+// word j after it that goes with it, the words after j that go with both are
+// gathered block by block into candidates, then every pair a < b of those
+// that go together is tried with every last word that goes with all four.
+//
+// What a word's letters are, and what going together means, comes from a
+// Letters policy with:
+//
+//   Mask                    a word's letters, and what's left of the letters
+//                           once some words have been used
+//   fits(left, word)        whether word can be used with left still left
+//   minus(left, word)       what's left once word, which fits, is used
+//   known_bad(left_ij)      whether the pair leaving left_ij is known not to
+//   set_bad(left_ij)        lead to a solution, and marking it so, for a
+//                           memo of pairs (or nothing)
+//   close(left_ijkl, candidate_masks, candidate_ids, b, each)
+//                           call each with the id of every word fitting
+//                           left_ijkl that comes after candidate b
+//
+// BitmapLetters and IndexedLetters here are the policies for bitmaps.
+
+#ifndef FIVE_WORDS_SEARCH_H
+#define FIVE_WORDS_SEARCH_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "five_words.h"
+#include "perf_counters.h"
+#include "stop_control.h"
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace five_words {
+
+// The words of a dictionary as the search sees them, by id: masks[n] is the
+// letters of word n, and the words from boundaries[n] up to boundaries[n + 1]
+// all have the letters of blocks[n], so a block is only looked through if
+// those still fit. full is what's left before any words are used.
+template <typename Mask> struct SearchWords {
+  const std::vector<Mask> &masks;
+  const std::vector<size_t> &boundaries;
+  const std::vector<Mask> &blocks;
+  Mask full;
+};
+
+// Call each with the id of every one of the candidates after b that fits
+// left_ijkl, for policies without a quicker way
+template <typename Letters, typename Mask, typename Each>
+inline void scan_closing_words(const Letters &letters, const Mask &left_ijkl,
+                               const std::vector<Mask> &candidate_masks,
+                               const std::vector<uint32_t> &candidate_ids,
+                               size_t b, Each &&each) {
+  for (size_t c = b + 1; c < candidate_masks.size(); c++)
+    if (letters.fits(left_ijkl, candidate_masks[c]))
+      each(candidate_ids[c]);
+}
+
+// Letters as bits of a Mask, left being the ones not used yet. There's no
+// memo, as one over every pair's letters would need a bit for every subset of
+// the alphabet, and the last word is scanned for among the candidates.
+template <typename Mask> class BitmapLetters {
+public:
+  bool fits(Mask left, Mask word) const { return (word & ~left) == 0; }
+  Mask minus(Mask left, Mask word) const { return left & ~word; }
+
+  bool known_bad(Mask) const { return false; }
+  void set_bad(Mask) const {}
+
+  template <typename Each>
+  void close(Mask left_ijkl, const std::vector<Mask> &candidate_masks,
+             const std::vector<uint32_t> &candidate_ids, size_t b,
+             Each &&each) const {
+    scan_closing_words(*this, left_ijkl, candidate_masks, candidate_ids, b,
+                       each);
+  }
+};
+
+// Letters as the bits of a uint32_t, all_letters being every letter there is,
+// with closing_words to look up the last word in rather than scanning for it,
+// and, for 26 letters or fewer, a memo of the letters used by pairs known not
+// to lead to a solution (or nullptr for none)
+class IndexedLetters : public BitmapLetters<uint32_t> {
+public:
+  IndexedLetters(uint32_t all_letters, EpochBitset *memo,
+                 const ClosingWords &closing_words)
+      : all_letters_(all_letters), memo_(memo),
+        closing_words_(closing_words) {}
+
+  bool known_bad(uint32_t left_ij) const {
+    return memo_ != nullptr && memo_->test(all_letters_ & ~left_ij);
+  }
+  void set_bad(uint32_t left_ij) const {
+    if (memo_ != nullptr)
+      memo_->set(all_letters_ & ~left_ij);
+  }
+
+  // Any word made of letters left after b is a candidate, since it has none
+  // of the letters of i and j and its id is past j
+  template <typename Each>
+  void close(uint32_t left_ijkl, const std::vector<uint32_t> &,
+             const std::vector<uint32_t> &candidate_ids, size_t b,
+             Each &&each) const {
+    const uint32_t after = candidate_ids[b];
+    closing_words_.for_each_word(left_ijkl, [&](uint32_t c) {
+      if (c > after)
+        each(c);
+    });
+  }
+
+private:
+  uint32_t all_letters_;
+  EpochBitset *memo_;
+  const ClosingWords &closing_words_;
+};
+
+// Pass every solution whose first two words are i and j, leaving left_ij, to
+// found, using the candidate vectors as scratch space. Marks the pair in the
+// memo if it has none.
+template <typename Letters, typename Mask, typename Found>
+void search_pair(const Letters &letters, const SearchWords<Mask> &words,
+                 size_t i, size_t j, const Mask &left_ij,
+                 std::vector<Mask> &candidate_masks,
+                 std::vector<uint32_t> &candidate_ids, Found &&found) {
+  if (letters.known_bad(left_ij))
+    return;
+
+  // Prune the remaining words down to a set of candidates that go with both
+  // words so far, skipping any block whose letters are used up
+  candidate_masks.clear();
+  candidate_ids.clear();
+  for (size_t index = 0; index < words.boundaries.size() - 1; index++) {
+    if (!letters.fits(left_ij, words.blocks[index]))
+      continue;
+    for (size_t k = std::max(j + 1, words.boundaries[index]);
+         k < words.boundaries[index + 1]; k++) {
+      if (letters.fits(left_ij, words.masks[k])) {
+        candidate_masks.push_back(words.masks[k]);
+        candidate_ids.push_back(static_cast<uint32_t>(k));
+      }
+    }
+  }
+
+  const size_t num_candidates = candidate_masks.size();
+  if (num_candidates < WORD_LENGTH - 2)
+    return;
+
+  bool any = false;
+  // From here, only search through the pruned set of candidates
+  for (size_t a = 0; a < num_candidates; a++) {
+    const Mask left_ijk = letters.minus(left_ij, candidate_masks[a]);
+    for (size_t b = a + 1; b < num_candidates; b++) {
+      if (!letters.fits(left_ijk, candidate_masks[b]))
+        continue;
+      const Mask left_ijkl = letters.minus(left_ijk, candidate_masks[b]);
+      letters.close(left_ijkl, candidate_masks, candidate_ids, b,
+                    [&](uint32_t c) {
+                      any = true;
+                      const Solution solution = {
+                          {static_cast<uint32_t>(i), static_cast<uint32_t>(j),
+                           candidate_ids[a], candidate_ids[b], c}};
+                      found(solution);
+                    });
+    }
+  }
+  if (!any)
+    letters.set_bad(left_ij);
+}
+
+// The whole search of words, on a team of threads sharing out the first
+// words. Honors everything in options but excluded_letters and reuse_memo,
+// which are up to the caller to build into words.full and letters.
+template <typename Letters, typename Mask>
+StopReason search(const Letters &letters, const SearchWords<Mask> &words,
+                  const Options &options, Visitor &visitor) {
+  const size_t number_of_words = words.masks.size();
+  const std::vector<uint32_t> *first_words = options.first_words;
+  const size_t number_of_first_words =
+      first_words != nullptr ? first_words->size() : number_of_words;
+#ifdef _OPENMP
+  const int threads =
+      options.threads > 0 ? options.threads : omp_get_max_threads();
+#else
+  const int threads = 1;
+#endif
+
+  if (options.thread_busy_seconds != nullptr)
+    options.thread_busy_seconds->assign(threads, 0.0);
+
+  StopControl stop(options);
+
+#pragma omp parallel num_threads(threads) shared(stop)
+  {
+    const auto thread_start = std::chrono::steady_clock::now();
+    std::vector<Mask> candidate_masks;
+    std::vector<uint32_t> candidate_ids;
+
+    std::unique_ptr<PerfCounters> thread_counters;
+    if (options.events != nullptr) {
+      stop.guard([&]() {
+        thread_counters.reset(new PerfCounters());
+        thread_counters->start();
+      });
+    }
+
+#pragma omp for schedule(dynamic) nowait
+    for (size_t n = 0; n < number_of_first_words; n++) {
+      const size_t i = first_words != nullptr ? (*first_words)[n] : n;
+      if (!letters.fits(words.full, words.masks[i]))
+        continue;
+      stop.guard([&]() {
+        const Mask left_i = letters.minus(words.full, words.masks[i]);
+        for (size_t j = i + 1; j < number_of_words; j++) {
+          if (stop.stopped())
+            break;
+          if (!letters.fits(left_i, words.masks[j]))
+            continue;
+          search_pair(letters, words, i, j,
+                      letters.minus(left_i, words.masks[j]), candidate_masks,
+                      candidate_ids, [&](const Solution &solution) {
+                        stop.found(solution, visitor);
+                      });
+        }
+        if (!stop.stopped())
+          visitor.finished_first_word(static_cast<uint32_t>(i));
+      });
+    }
+
+    if (thread_counters) {
+      const PerfSample sample = thread_counters->stop();
+#pragma omp critical
+      *options.events += sample;
+    }
+
+    if (options.thread_busy_seconds != nullptr) {
+#ifdef _OPENMP
+      const int thread = omp_get_thread_num();
+#else
+      const int thread = 0;
+#endif
+      (*options.thread_busy_seconds)[thread] =
+          std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                        thread_start)
+              .count();
+    }
+  }
+
+  stop.rethrow();
+  return stop.reason();
+}
+
+} // namespace five_words
+
+#endif
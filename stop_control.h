@@ -0,0 +1,124 @@
+// This program is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+// for more details.
+
+// You should have received a copy of the GNU General Public License along
+// with this program. If not, see <https://www.gnu.org/licenses/>.
+
+// Internal to the library, shared by the searches
+
+#ifndef FIVE_WORDS_STOP_CONTROL_H
+#define FIVE_WORDS_STOP_CONTROL_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <thread>
+
+#include "five_words.h"
+
+namespace five_words {
+
+// Decides when a search should wind down early, shared by every thread of it.
+// Threads check stopped() before starting on another piece of work, so the
+// piece in flight is always finished and the memo stays exact.
+class StopControl {
+public:
+  // Rather than having the workers poll the clock, park a thread until the
+  // deadline and have it raise the flag.
+  explicit StopControl(const Options &options) : limit_(options.limit) {
+    if (options.has_deadline) {
+      watchdog_ = std::thread([this, &options]() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (!finished_cv_.wait_until(lock, options.deadline,
+                                     [this]() { return finished_; }))
+          request(DEADLINE_PASSED);
+      });
+    }
+  }
+
+  ~StopControl() {
+    if (watchdog_.joinable()) {
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        finished_ = true;
+      }
+      finished_cv_.notify_all();
+      watchdog_.join();
+    }
+  }
+
+  bool stopped() const {
+    return reason_.load(std::memory_order_relaxed) != NOT_STOPPED;
+  }
+
+  // Only the first reason given sticks
+  void request(StopReason reason) {
+    int expected = NOT_STOPPED;
+    reason_.compare_exchange_strong(expected, reason);
+  }
+
+  // Hand a solution to visitor, unless the limit has already been reached.
+  // The search only stops for the limit on finding a solution past it, so
+  // one with exactly limit solutions still ends up complete.
+  template <typename Found, typename FoundVisitor>
+  void found(const Found &solution, FoundVisitor &visitor) {
+    const size_t number = ++solutions_found_;
+    if (limit_ == 0 || number <= limit_) {
+      if (!visitor.visit(solution))
+        request(VISITOR_STOPPED);
+    } else {
+      request(LIMIT_REACHED);
+    }
+  }
+
+  // Run body, and if it throws keep the first exception thrown on any thread
+  // and stop the search, for rethrow() to pass on once the threads are done.
+  // An exception mustn't leave the thread it was thrown on, let alone the
+  // OpenMP region or worksharing loop it was thrown in.
+  template <typename Body> void guard(Body body) {
+    try {
+      body();
+    } catch (...) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (!error_)
+        error_ = std::current_exception();
+      reason_.store(FAILED);
+    }
+  }
+
+  // Rethrow what guard() caught, if anything, on the calling thread
+  void rethrow() const {
+    if (error_)
+      std::rethrow_exception(error_);
+  }
+
+  StopReason reason() const { return static_cast<StopReason>(reason_.load()); }
+
+private:
+  // Stops every thread, taking precedence over the other reasons, but never
+  // seen outside as it's rethrown instead
+  static constexpr int FAILED = -1;
+
+  const size_t limit_;
+  std::atomic<int> reason_{NOT_STOPPED};
+  std::atomic<size_t> solutions_found_{0};
+  std::exception_ptr error_;
+  std::mutex mutex_;
+  std::condition_variable finished_cv_;
+  bool finished_ = false;
+  std::thread watchdog_;
+};
+
+} // namespace five_words
+
+#endif
@@ -0,0 +1,153 @@
+// This program is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+// for more details.
+
+// You should have received a copy of the GNU General Public License along
+// with this program. If not, see <https://www.gnu.org/licenses/>.
+
+#include "text_output.h"
+
+#include <cstring>
+#include <fstream>
+#include <functional>
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#define FIVE_WORDS_HAVE_MMAP 1
+#endif
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace five_words {
+
+namespace {
+
+// Format solutions on threads threads. Once the length of the whole text is
+// known, place is called (on one thread) for where to put it, and returns
+// nullptr if there's nowhere. Returns false if there wasn't.
+bool format_into(const Dictionary &dictionary,
+                 const std::vector<Solution> &solutions, int threads,
+                 const std::function<char *(size_t bytes)> &place) {
+#ifdef _OPENMP
+  if (threads <= 0)
+    threads = omp_get_max_threads();
+#else
+  threads = 1;
+#endif
+
+  // Where each thread's share starts, once summed
+  std::vector<size_t> offsets(threads + 1, 0);
+  char *text = nullptr;
+  bool placed = true;
+
+#pragma omp parallel num_threads(threads)
+  {
+#ifdef _OPENMP
+    const size_t thread = omp_get_thread_num();
+    const size_t team = omp_get_num_threads();
+#else
+    const size_t thread = 0;
+    const size_t team = 1;
+#endif
+    const size_t begin = solutions.size() * thread / team;
+    const size_t end = solutions.size() * (thread + 1) / team;
+
+    size_t bytes = 0;
+    for (size_t n = begin; n < end; n++) {
+      for (const auto id : solutions[n])
+        bytes += dictionary.word(id).size() + 1;
+      bytes++;
+    }
+    offsets[thread + 1] = bytes;
+
+#pragma omp barrier
+#pragma omp single
+    {
+      for (size_t t = 1; t <= team; t++)
+        offsets[t] += offsets[t - 1];
+      if (offsets[team] > 0) {
+        text = place(offsets[team]);
+        placed = text != nullptr;
+      }
+    }
+
+    if (text != nullptr) {
+      char *next = text + offsets[thread];
+      for (size_t n = begin; n < end; n++) {
+        for (const auto id : solutions[n]) {
+          const std::string &word = dictionary.word(id);
+          std::memcpy(next, word.data(), word.size());
+          next += word.size();
+          *next++ = ' ';
+        }
+        *next++ = '\n';
+      }
+    }
+  }
+
+  return placed;
+}
+
+} // namespace
+
+void format_solutions(const Dictionary &dictionary,
+                      const std::vector<Solution> &solutions,
+                      std::string &text, int threads) {
+  text.clear();
+  format_into(dictionary, solutions, threads, [&text](size_t bytes) {
+    text.resize(bytes);
+    return &text[0];
+  });
+}
+
+bool write_solutions_file(const std::string &filename,
+                          const Dictionary &dictionary,
+                          const std::vector<Solution> &solutions,
+                          int threads) {
+#ifdef FIVE_WORDS_HAVE_MMAP
+  const int fd = open(filename.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0666);
+  if (fd < 0)
+    return false;
+  void *mapping = nullptr;
+  size_t mapped_bytes = 0;
+  const bool placed =
+      format_into(dictionary, solutions, threads,
+                  [fd, &mapping, &mapped_bytes](size_t bytes) -> char * {
+                    if (ftruncate(fd, bytes) != 0)
+                      return nullptr;
+                    void *p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE,
+                                   MAP_SHARED, fd, 0);
+                    if (p == MAP_FAILED)
+                      return nullptr;
+                    mapping = p;
+                    mapped_bytes = bytes;
+                    return static_cast<char *>(p);
+                  });
+  // Leave writing the pages back to the kernel, as with any other write
+  if (mapping != nullptr)
+    munmap(mapping, mapped_bytes);
+  const bool closed = close(fd) == 0;
+  if (placed)
+    return closed;
+  // Somewhere that can't be mapped, e.g. a pipe
+#endif
+
+  std::string text;
+  format_solutions(dictionary, solutions, text, threads);
+  std::ofstream out(filename, std::ios::binary | std::ios::trunc);
+  out.write(text.data(), text.size());
+  out.flush();
+  return static_cast<bool>(out);
+}
+
+} // namespace five_words
@@ -0,0 +1,46 @@
+// This program is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+// for more details.
+
+// You should have received a copy of the GNU General Public License along
+// with this program. If not, see <https://www.gnu.org/licenses/>.
+
+// Formatting solutions as text on every thread. Each thread takes a share of
+// the solutions and adds up the length of their lines, the lengths are
+// prefix summed into where each share starts, and then every thread formats
+// its share straight into place, so there's no copying of pieces together
+// afterwards and no thread waits on another.
+
+#ifndef FIVE_WORDS_TEXT_OUTPUT_H
+#define FIVE_WORDS_TEXT_OUTPUT_H
+
+#include <string>
+#include <vector>
+
+#include "five_words.h"
+
+namespace five_words {
+
+// Format solutions into text, one per line, each word followed by a space.
+// threads is the size of the OpenMP team (0 for the OpenMP default).
+void format_solutions(const Dictionary &dictionary,
+                      const std::vector<Solution> &solutions,
+                      std::string &text, int threads = 0);
+
+// Same, into the file filename, which is mapped for the threads to write
+// into (or written out from memory where it can't be). Returns false if the
+// file couldn't be written.
+bool write_solutions_file(const std::string &filename,
+                          const Dictionary &dictionary,
+                          const std::vector<Solution> &solutions,
+                          int threads = 0);
+
+} // namespace five_words
+
+#endif
@@ -0,0 +1,507 @@
+// This program is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+// for more details.
+
+// You should have received a copy of the GNU General Public License along
+// with this program. If not, see <https://www.gnu.org/licenses/>.
+
+#include "word_input.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define FIVE_WORDS_HAVE_POSIX_IO 1
+#endif
+
+// Defined by the Makefile when the libraries are installed
+#ifdef FIVE_WORDS_HAVE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef FIVE_WORDS_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+namespace five_words {
+
+namespace {
+
+// Text is handed over in chunks this big. Decompressed text gets room for
+// this many in flight, while uncompressed text is double buffered, one chunk
+// being split into lines while read(2) fills the other. Compressed input is
+// read this much at a time.
+constexpr size_t CHUNK_SIZE = size_t(1) << 20;
+constexpr size_t DECOMPRESSED_CHUNKS = 4;
+constexpr size_t UNCOMPRESSED_CHUNKS = 2;
+constexpr size_t INPUT_SIZE = size_t(1) << 18;
+
+// What went wrong with the last read_lines on this thread
+thread_local std::string last_read_error;
+
+// A file, or standard input for "-", read with read(2) where there is one.
+// The first few bytes can be peeked at, to see if they're compressed, and
+// are then read again like the rest.
+class Input {
+public:
+  Input() = default;
+  ~Input() {
+#ifdef FIVE_WORDS_HAVE_POSIX_IO
+    if (fd_ > STDIN_FILENO)
+      ::close(fd_);
+#else
+    if (file_ != nullptr && file_ != stdin)
+      std::fclose(file_);
+#endif
+  }
+
+  Input(const Input &) = delete;
+  Input &operator=(const Input &) = delete;
+
+  bool open(const std::string &filename) {
+#ifdef FIVE_WORDS_HAVE_POSIX_IO
+    fd_ = filename == "-" ? STDIN_FILENO : ::open(filename.c_str(), O_RDONLY);
+    return fd_ >= 0;
+#else
+    file_ = filename == "-" ? stdin : std::fopen(filename.c_str(), "rb");
+    return file_ != nullptr;
+#endif
+  }
+
+  // Up to size bytes from the start of the input, fewer if it's shorter
+  size_t peek(unsigned char *bytes, size_t size) {
+    while (peeked_.size() < size && !error_) {
+      unsigned char byte[1];
+      if (read_some(byte, 1) == 0)
+        break;
+      peeked_.push_back(byte[0]);
+    }
+    std::copy(peeked_.begin(), peeked_.begin() + std::min(size, peeked_.size()),
+              bytes);
+    return std::min(size, peeked_.size());
+  }
+
+  // Read up to size bytes, or 0 at the end of the input or on an error
+  size_t read(void *buffer, size_t size) {
+    if (peeked_position_ < peeked_.size()) {
+      const size_t bytes = std::min(size, peeked_.size() - peeked_position_);
+      std::memcpy(buffer, peeked_.data() + peeked_position_, bytes);
+      peeked_position_ += bytes;
+      return bytes;
+    }
+    return read_some(buffer, size);
+  }
+
+  bool error() const { return error_; }
+
+private:
+  size_t read_some(void *buffer, size_t size) {
+#ifdef FIVE_WORDS_HAVE_POSIX_IO
+    for (;;) {
+      const ssize_t bytes = ::read(fd_, buffer, size);
+      if (bytes >= 0)
+        return bytes;
+      if (errno != EINTR) {
+        error_ = true;
+        return 0;
+      }
+    }
+#else
+    const size_t bytes = std::fread(buffer, 1, size, file_);
+    error_ = error_ || std::ferror(file_);
+    return bytes;
+#endif
+  }
+
+#ifdef FIVE_WORDS_HAVE_POSIX_IO
+  int fd_ = -1;
+#else
+  std::FILE *file_ = nullptr;
+#endif
+  std::vector<unsigned char> peeked_;
+  size_t peeked_position_ = 0;
+  bool error_ = false;
+};
+
+struct Chunk {
+  std::vector<char> bytes;
+  size_t size = 0;
+};
+
+// A ring of chunks passed from one thread that fills them to another that
+// reads them. Either side blocks while it has to wait for the other.
+class ChunkRing {
+public:
+  explicit ChunkRing(size_t chunks) : chunks_(chunks) {
+    for (auto &chunk : chunks_)
+      chunk.bytes.resize(CHUNK_SIZE);
+  }
+
+  // The next empty chunk to fill, or nullptr if the reader has given up
+  Chunk *to_fill() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    changed_.wait(lock,
+                  [this] { return abandoned_ || full_ < chunks_.size(); });
+    if (abandoned_)
+      return nullptr;
+    Chunk &chunk = chunks_[fill_];
+    chunk.size = 0;
+    return &chunk;
+  }
+
+  // Pass the chunk from to_fill() on to the reader
+  void filled() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    fill_ = (fill_ + 1) % chunks_.size();
+    full_++;
+    changed_.notify_all();
+  }
+
+  // No more chunks are coming, because the input ended (ok) or was bad
+  void close(bool ok) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    closed_ = true;
+    ok_ = ok;
+    changed_.notify_all();
+  }
+
+  // The next full chunk, or nullptr once they've all been read and the ring
+  // is closed
+  const Chunk *to_read() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    changed_.wait(lock, [this] { return closed_ || full_ > 0; });
+    return full_ > 0 ? &chunks_[read_] : nullptr;
+  }
+
+  // Hand the chunk from to_read() back to be filled again
+  void read() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    read_ = (read_ + 1) % chunks_.size();
+    full_--;
+    changed_.notify_all();
+  }
+
+  // Stop the filling thread, e.g. if the reader has thrown
+  void abandon() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    abandoned_ = true;
+    changed_.notify_all();
+  }
+
+  bool ok() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return ok_;
+  }
+
+private:
+  std::vector<Chunk> chunks_;
+  size_t fill_ = 0;
+  size_t read_ = 0;
+  size_t full_ = 0;
+  bool closed_ = false;
+  bool ok_ = true;
+  bool abandoned_ = false;
+  std::mutex mutex_;
+  std::condition_variable changed_;
+};
+
+#ifdef FIVE_WORDS_HAVE_ZLIB
+// Inflate a gzip file, which may be several gzip members one after another
+// (as from cat a.gz b.gz), into ring. Returns false if it's corrupt or cut
+// short.
+bool inflate_gzip(Input &file, ChunkRing &ring) {
+  z_stream stream;
+  std::memset(&stream, 0, sizeof(stream));
+  // 32 to take either a gzip or a zlib header
+  if (inflateInit2(&stream, 15 + 32) != Z_OK)
+    return false;
+
+  std::vector<unsigned char> input(INPUT_SIZE);
+  Chunk *chunk = ring.to_fill();
+  int status = Z_OK;
+  bool output_full = false;
+  bool ok = false;
+  while (chunk != nullptr) {
+    if (status == Z_STREAM_END || (stream.avail_in == 0 && !output_full)) {
+      if (stream.avail_in == 0) {
+        stream.next_in = input.data();
+        stream.avail_in =
+            static_cast<unsigned>(file.read(input.data(), input.size()));
+      }
+      if (stream.avail_in == 0) {
+        ok = status == Z_STREAM_END && !file.error();
+        break;
+      }
+      if (status == Z_STREAM_END && inflateReset(&stream) != Z_OK)
+        break;
+    }
+
+    stream.next_out =
+        reinterpret_cast<unsigned char *>(chunk->bytes.data() + chunk->size);
+    stream.avail_out = static_cast<unsigned>(chunk->bytes.size() - chunk->size);
+    status = inflate(&stream, Z_NO_FLUSH);
+    if (status != Z_OK && status != Z_STREAM_END && status != Z_BUF_ERROR)
+      break;
+    output_full = stream.avail_out == 0;
+    chunk->size = chunk->bytes.size() - stream.avail_out;
+    if (output_full) {
+      ring.filled();
+      chunk = ring.to_fill();
+    }
+  }
+
+  inflateEnd(&stream);
+  if (chunk != nullptr && chunk->size > 0)
+    ring.filled();
+  return ok;
+}
+#endif
+
+#ifdef FIVE_WORDS_HAVE_ZSTD
+// Decompress a zstd file, which may be several frames one after another, into
+// ring. Returns false if it's corrupt or cut short.
+bool decompress_zstd(Input &file, ChunkRing &ring) {
+  ZSTD_DStream *stream = ZSTD_createDStream();
+  if (stream == nullptr)
+    return false;
+  ZSTD_initDStream(stream);
+
+  std::vector<unsigned char> buffer(INPUT_SIZE);
+  ZSTD_inBuffer input = {buffer.data(), 0, 0};
+  Chunk *chunk = ring.to_fill();
+  // 0 once a frame is finished and flushed
+  size_t hint = 1;
+  bool output_full = false;
+  bool ok = false;
+  while (chunk != nullptr) {
+    if (input.pos == input.size && !output_full) {
+      input.size = file.read(buffer.data(), buffer.size());
+      input.pos = 0;
+      if (input.size == 0) {
+        ok = hint == 0 && !file.error();
+        break;
+      }
+    }
+
+    ZSTD_outBuffer output = {chunk->bytes.data(), chunk->bytes.size(),
+                             chunk->size};
+    hint = ZSTD_decompressStream(stream, &output, &input);
+    if (ZSTD_isError(hint))
+      break;
+    output_full = output.pos == output.size;
+    chunk->size = output.pos;
+    if (output_full) {
+      ring.filled();
+      chunk = ring.to_fill();
+    }
+  }
+
+  ZSTD_freeDStream(stream);
+  if (chunk != nullptr && chunk->size > 0)
+    ring.filled();
+  return ok;
+}
+#endif
+
+// Copy uncompressed input into ring as it is
+bool copy_text(Input &file, ChunkRing &ring) {
+  for (Chunk *chunk = ring.to_fill(); chunk != nullptr;
+       chunk = ring.to_fill()) {
+    chunk->size = file.read(chunk->bytes.data(), chunk->bytes.size());
+    if (chunk->size == 0)
+      break;
+    ring.filled();
+  }
+  return !file.error();
+}
+
+// Read (and decompress) file on another thread while splitting what comes out
+// of it into lines on this one
+bool read_lines(Input &file, Compression compression,
+                const std::function<void(std::string &)> &line) {
+  ChunkRing ring(compression == Compression::NONE ? UNCOMPRESSED_CHUNKS
+                                                  : DECOMPRESSED_CHUNKS);
+  std::thread reader([&file, compression, &ring] {
+    bool ok = false;
+    if (compression == Compression::NONE)
+      ok = copy_text(file, ring);
+#ifdef FIVE_WORDS_HAVE_ZLIB
+    if (compression == Compression::GZIP)
+      ok = inflate_gzip(file, ring);
+#endif
+#ifdef FIVE_WORDS_HAVE_ZSTD
+    if (compression == Compression::ZSTD)
+      ok = decompress_zstd(file, ring);
+#endif
+    ring.close(ok);
+  });
+
+  try {
+    std::string text;
+    while (const Chunk *chunk = ring.to_read()) {
+      const char *next = chunk->bytes.data();
+      const char *const end = next + chunk->size;
+      while (next != end) {
+        const char *newline =
+            static_cast<const char *>(std::memchr(next, '\n', end - next));
+        if (newline == nullptr) {
+          // The rest of the line is in the next chunk
+          text.append(next, end);
+          break;
+        }
+        text.append(next, newline);
+        line(text);
+        text.clear();
+        next = newline + 1;
+      }
+      ring.read();
+    }
+    // Like std::getline, a last line without a newline still counts
+    if (!text.empty())
+      line(text);
+  } catch (...) {
+    ring.abandon();
+    reader.join();
+    throw;
+  }
+
+  reader.join();
+  return ring.ok();
+}
+
+} // namespace
+
+Compression detect_compression(const unsigned char *bytes, size_t size) {
+  if (size >= 2 && bytes[0] == 0x1f && bytes[1] == 0x8b)
+    return Compression::GZIP;
+  if (size >= 4 && bytes[0] == 0x28 && bytes[1] == 0xb5 && bytes[2] == 0x2f &&
+      bytes[3] == 0xfd)
+    return Compression::ZSTD;
+  return Compression::NONE;
+}
+
+bool can_decompress(Compression compression) {
+  switch (compression) {
+  case Compression::NONE:
+    return true;
+  case Compression::GZIP:
+#ifdef FIVE_WORDS_HAVE_ZLIB
+    return true;
+#else
+    return false;
+#endif
+  case Compression::ZSTD:
+#ifdef FIVE_WORDS_HAVE_ZSTD
+    return true;
+#else
+    return false;
+#endif
+  }
+  return false;
+}
+
+bool read_lines(const std::string &filename,
+                const std::function<void(std::string &)> &line) {
+  std::string &error = last_read_error;
+  error.clear();
+  Input file;
+  if (!file.open(filename)) {
+    error = "Could not open file: " + filename;
+    return false;
+  }
+  unsigned char magic[4];
+  const size_t magic_size = file.peek(magic, sizeof(magic));
+  const Compression compression = detect_compression(magic, magic_size);
+  if (!can_decompress(compression)) {
+    error = compression == Compression::GZIP
+                ? "Could not decompress .gz file " + filename +
+                      ": built without zlib"
+                : "Could not decompress .zst file " + filename +
+                      ": built without libzstd";
+    return false;
+  }
+  if (!read_lines(file, compression, line)) {
+    error = compression == Compression::NONE
+                ? "Could not read file: " + filename
+                : "Could not decompress " + filename +
+                      ": corrupt or cut short";
+    return false;
+  }
+  return true;
+}
+
+const std::string &read_error() { return last_read_error; }
+
+bool is_regular_file(const std::string &filename) {
+  if (filename == "-")
+    return false;
+#ifdef FIVE_WORDS_HAVE_POSIX_IO
+  struct stat status;
+  return stat(filename.c_str(), &status) == 0 && S_ISREG(status.st_mode);
+#else
+  return true;
+#endif
+}
+
+MappedFile::~MappedFile() {
+#ifdef FIVE_WORDS_HAVE_POSIX_IO
+  if (mapping_ != nullptr)
+    munmap(mapping_, size_);
+#endif
+}
+
+bool MappedFile::open(const std::string &filename) {
+#ifdef FIVE_WORDS_HAVE_POSIX_IO
+  const int fd = ::open(filename.c_str(), O_RDONLY);
+  if (fd < 0)
+    return false;
+  struct stat status;
+  if (fstat(fd, &status) == 0 && S_ISREG(status.st_mode)) {
+    size_ = status.st_size;
+    if (size_ == 0) {
+      ::close(fd);
+      return true;
+    }
+    void *mapping = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (mapping != MAP_FAILED) {
+      // Every page is about to be read, just not in order
+      madvise(mapping, size_, MADV_WILLNEED);
+      ::close(fd);
+      mapping_ = mapping;
+      data_ = static_cast<const char *>(mapping);
+      return true;
+    }
+  }
+  ::close(fd);
+#endif
+
+  std::ifstream file(filename, std::ios::binary);
+  if (!file.is_open())
+    return false;
+  contents_.assign(std::istreambuf_iterator<char>(file),
+                   std::istreambuf_iterator<char>());
+  size_ = contents_.size();
+  data_ = contents_.data();
+  return true;
+}
+
+} // namespace five_words
@@ -0,0 +1,88 @@
+// This program is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+// for more details.
+
+// You should have received a copy of the GNU General Public License along
+// with this program. If not, see <https://www.gnu.org/licenses/>.
+
+// Reading word lists that may be compressed, from files or from standard
+// input. The input is read, and a gzip or zstd file decompressed, on a thread
+// of its own into a ring of buffers, which the calling thread splits into
+// lines as they fill, so the two overlap and nothing is written to disk. An
+// uncompressed file can instead be mapped whole, for several threads to parse
+// pieces of at once.
+
+#ifndef FIVE_WORDS_WORD_INPUT_H
+#define FIVE_WORDS_WORD_INPUT_H
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace five_words {
+
+enum class Compression { NONE, GZIP, ZSTD };
+
+// What the first size bytes of a file say it's compressed with, going by
+// their magic number rather than the file name
+Compression detect_compression(const unsigned char *bytes, size_t size);
+
+// Whether this build can decompress the given format. That's gzip if it was
+// built with zlib and zstd if it was built with libzstd (see the Makefile).
+bool can_decompress(Compression compression);
+
+// Call line on each line of filename, or of standard input if filename is
+// "-", without its newline, decompressing it first if need be. Works on pipes,
+// as it never seeks. line may modify the string it's given. Returns false if
+// the file couldn't be opened, is compressed with something this build
+// can't decompress, or turns out to be corrupt part way through (after the
+// lines before that point have been passed on).
+bool read_lines(const std::string &filename,
+                const std::function<void(std::string &)> &line);
+
+// Why the last read_lines on this thread (or anything reading through it,
+// like read_word_list) returned false, as a message naming the file: that it
+// couldn't be opened, that it's compressed with something this build can't
+// decompress and which library that would take, or that it couldn't be read
+// to the end. Empty if it succeeded.
+const std::string &read_error();
+
+// Whether filename is a regular file, as opposed to standard input ("-"), a
+// pipe (including a FIFO or a process substitution like <(...)) or a device,
+// so that it can be mapped, or opened a second time and read again from the
+// start
+bool is_regular_file(const std::string &filename);
+
+// The whole of a (named) file in memory: mapped read only where possible,
+// read in otherwise
+class MappedFile {
+public:
+  MappedFile() = default;
+  ~MappedFile();
+
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+
+  // Returns false if the file couldn't be opened or read
+  bool open(const std::string &filename);
+
+  const char *data() const { return data_; }
+  size_t size() const { return size_; }
+
+private:
+  const char *data_ = nullptr;
+  size_t size_ = 0;
+  void *mapping_ = nullptr;
+  std::vector<char> contents_;
+};
+
+} // namespace five_words
+
+#endif